@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "antialias.h"
+#include "scheduler.h"
+#include "trace.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+namespace
+{
+//! @brief samples an edge pixel takes per round, one per quadrant; the
+//         first round takes one, a pixel that agrees with it stops there
+const int ROUND = 4;
+//! @brief quadrant of the k-th sample of a round and cell of the quadrant
+//         used by the k-th round, diagonal first, so that 16 samples are
+//         a jittered 4x4 grid
+const int DIAGONAL[4] = {0, 3, 1, 2};
+
+uint32_t hash(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+//! @brief in [0, 1), the same for a pixel and sample in every run, so a
+//         frame rendered again is identical
+double jitter(const uint32_t pixel, const int sample, const uint32_t axis)
+{
+	return (hash(pixel*131u + static_cast<uint32_t>(sample)*2u + axis) >> 8)*(1.0/16777216.0);
+}
+
+int channel(const uint32_t color, const int c)
+{
+	return (color >> (8*c)) & 0xFF;
+}
+
+struct EdgePixel
+{
+	int x, y;
+	double sum[3];
+	int taken;
+	bool done;
+	//! @brief iterations of one sample; how far the last round moved the
+	//         color, at first the edge contrast
+	float cost;
+	double spread;
+};
+} // namespace
+
+std::string FRACTAL::AntiAlias::Stats::info() const
+{
+	return cv::format(
+		"AntiAlias::%.1f%% edge pixels, %.1f samples each, %.1f%% converged, %.1f%% over budget, %.1f ms",
+		pixels ? 100.0*edges/pixels : 0.0,
+		edges ? static_cast<double>(samples)/edges : 0.0,
+		edges ? 100.0*converged/edges : 0.0,
+		edges ? 100.0*capped/edges : 0.0,
+		ms
+	);
+}
+
+std::vector<uint8_t> FRACTAL::AntiAlias::edges(
+	const std::vector<uint32_t>& color,
+	const int width,
+	const int height,
+	const int threshold
+)
+{
+	std::vector<uint8_t> edge(color.size(), 0);
+	cv::parallel_for_(
+		cv::Range(0, height),
+		[&](const cv::Range& rows) -> void
+		{
+			for(int y = rows.start; y < rows.end; ++y)
+			{
+				const uint32_t* up = &color[std::max(y - 1, 0)*width];
+				const uint32_t* row = &color[y*width];
+				const uint32_t* down = &color[std::min(y + 1, height - 1)*width];
+				for(int x = 0; x < width; ++x)
+				{
+					const uint32_t c = row[x];
+					const int x0 = std::max(x - 1, 0), x1 = std::min(x + 1, width - 1);
+					// most pixels are in flat bands, tell them apart first
+					if(up[x0] == c && up[x] == c && up[x1] == c && row[x0] == c
+						&& row[x1] == c && down[x0] == c && down[x] == c && down[x1] == c)
+						continue;
+					const int c0 = channel(c, 0), c1 = channel(c, 1), c2 = channel(c, 2);
+					int contrast = 0;
+					for(const uint32_t* r : {up, row, down})
+					{
+						for(int nx = x0; nx <= x1; ++nx)
+						{
+							const uint32_t d = r[nx];
+							contrast = std::max({
+								contrast,
+								std::abs(c0 - channel(d, 0)),
+								std::abs(c1 - channel(d, 1)),
+								std::abs(c2 - channel(d, 2))
+							});
+						}
+					}
+					edge[y*width + x] = contrast > threshold ? static_cast<uint8_t>(contrast) : 0;
+				}
+			}
+		}
+	);
+	return edge;
+}
+
+std::vector<float> FRACTAL::AntiAlias::costs(
+	const std::vector<int>& counts,
+	const std::vector<uint8_t>& edge,
+	const int iter_max
+)
+{
+	std::vector<float> cost(counts.size());
+	for(size_t p = 0; p < counts.size(); ++p)
+	{
+		if(counts[p] < iter_max)
+			cost[p] = static_cast<float>(std::max(counts[p], 0) + 1);
+		else
+			cost[p] = p < edge.size() && edge[p] ? static_cast<float>(iter_max) : 0.0f;
+	}
+	return cost;
+}
+
+AntiAlias::Stats FRACTAL::AntiAlias::render(
+	const CS<int>& scr,
+	const CS<double>& fract,
+	const std::vector<int>& counts,
+	const int iter_max,
+	const Palette& palette,
+	const PointEval& eval,
+	cv::Mat& bgr,
+	const RenderOptions& opts
+)
+{
+	const size_t pixels = static_cast<size_t>(scr.width())*scr.height();
+	if(opts.aa_samples < 1 || counts.size() != pixels)
+	{
+		Stats stats;
+		stats.pixels = pixels;
+		return stats;
+	}
+	const auto table = palette.lut(iter_max);
+	const auto& lut = *table;
+	const int last = static_cast<int>(lut.size()) - 1;
+	std::vector<uint32_t> color(pixels);
+	for(size_t p = 0; p < pixels; ++p)
+		color[p] = lut[std::min(std::max(counts[p], 0), last)];
+	const auto edge = edges(color, scr.width(), scr.height(), opts.aa_threshold);
+	return render(
+		scr,
+		fract,
+		color,
+		edge,
+		costs(counts, edge, iter_max),
+		[&eval, &lut, last](const double* cr, const double* ci, int n, uint32_t* out) -> void
+		{
+			thread_local std::vector<int> counts;
+			counts.resize(n);
+			eval(cr, ci, n, counts.data());
+			for(int k = 0; k < n; ++k)
+				out[k] = lut[std::min(std::max(counts[k], 0), last)];
+		},
+		bgr,
+		opts
+	);
+}
+
+AntiAlias::Stats FRACTAL::AntiAlias::render(
+	const CS<int>& scr,
+	const CS<double>& fract,
+	const std::vector<uint32_t>& color,
+	const std::vector<uint8_t>& edge,
+	const std::vector<float>& cost,
+	const ColorEval& eval,
+	cv::Mat& bgr,
+	const RenderOptions& opts
+)
+{
+	Trace::Span span("antialias");
+	auto start = std::chrono::steady_clock::now();
+	Stats stats;
+	const int width = scr.width(), height = scr.height();
+	stats.pixels = static_cast<size_t>(width)*height;
+	if(opts.aa_samples < 1 || color.size() != stats.pixels || edge.size() != stats.pixels
+		|| cost.size() != stats.pixels || bgr.rows != height || bgr.cols != width || bgr.type() != CV_8UC3)
+		return stats;
+
+	auto tiles = Scheduler::tiles(cv::Rect(0, 0, width, height), opts.tile);
+	std::vector<double> tile_cost(tiles.size(), 0.0);
+	for(size_t t = 0; t < tiles.size(); ++t)
+	{
+		const auto& rc = tiles[t];
+		for(int y = rc.y; y < rc.y + rc.height; ++y)
+			tile_cost[t] += rc.width - std::count(&edge[y*width + rc.x], &edge[y*width + rc.x + rc.width], 0);
+	}
+	const double sx = fract.width()/width, sy = fract.height()/height;
+	const int max_samples = opts.aa_samples;
+	const double tolerance = opts.aa_tolerance;
+	std::atomic<size_t> n_edges(0), n_samples(0), n_converged(0), n_capped(0);
+	Scheduler::run(
+		tiles,
+		tile_cost,
+		[&](const cv::Rect& rc, const size_t t) -> void
+		{
+			if(tile_cost[t] == 0.0)
+				return;
+			std::vector<EdgePixel> pixels;
+			double frame_cost = 0.0;
+			for(int y = rc.y; y < rc.y + rc.height; ++y)
+			{
+				for(int x = rc.x; x < rc.x + rc.width; ++x)
+				{
+					const int p = y*width + x;
+					frame_cost += cost[p];
+					if(!edge[p])
+						continue;
+					// the sample the renderer took, at the middle of the
+					// footprint, counts as the first
+					const uint32_t c = color[p];
+					pixels.push_back({x, y, {
+						static_cast<double>(channel(c, 0)),
+						static_cast<double>(channel(c, 1)),
+						static_cast<double>(channel(c, 2))
+					}, 0, false, cost[p], static_cast<double>(edge[p])});
+				}
+			}
+			// iterations the samples of the tile may take, given to the
+			// pixels that disagree most first
+			double left = opts.aa_budget > 0.0 ? opts.aa_budget*frame_cost : std::numeric_limits<double>::infinity();
+			std::vector<uint64_t> order;
+			std::vector<double> cr, ci;
+			std::vector<int> owner;
+			std::vector<uint32_t> out;
+			size_t taken = 0, converged = 0, capped = 0;
+			for(int round = 0; ; ++round)
+			{
+				// one sample first, then the rest of the quadrants
+				auto samples = [round, max_samples](const EdgePixel& px) -> int
+				{
+					return std::min(round ? ROUND - px.taken % ROUND : 1, max_samples - px.taken);
+				};
+				// by spread, largest first, then by pixel: the bits of a
+				// positive float order as it does
+				order.clear();
+				double wanted = 0.0;
+				for(size_t k = 0; k < pixels.size(); ++k)
+				{
+					if(pixels[k].done)
+						continue;
+					float spread = static_cast<float>(pixels[k].spread);
+					uint32_t bits;
+					std::memcpy(&bits, &spread, sizeof(bits));
+					order.push_back(static_cast<uint64_t>(~bits) << 32 | k);
+					wanted += samples(pixels[k])*static_cast<double>(pixels[k].cost);
+				}
+				if(wanted > left)
+					std::sort(order.begin(), order.end());
+				cr.clear();
+				ci.clear();
+				owner.clear();
+				for(const uint64_t key : order)
+				{
+					const int k = static_cast<int>(key & 0xFFFFFFFFu);
+					auto& px = pixels[k];
+					const int n = samples(px);
+					if(n*static_cast<double>(px.cost) > left)
+					{
+						px.done = true;
+						++capped;
+						continue;
+					}
+					left -= n*static_cast<double>(px.cost);
+					const uint32_t id = static_cast<uint32_t>(px.y*width + px.x);
+					for(int s = 0; s < n; ++s)
+					{
+						// stratified: a round puts one sample in each quadrant
+						// of the pixel, in a 4x4 cell of it not used yet,
+						// jittered inside the cell
+						const int sample = px.taken + s;
+						const int quadrant = DIAGONAL[sample & 3], cell = DIAGONAL[(sample >> 2) & 3];
+						const int gx = 2*(quadrant & 1) + (cell & 1);
+						const int gy = 2*(quadrant >> 1) + (cell >> 1);
+						const double dx = 0.25*(gx + jitter(id, sample, 0)) - 0.5;
+						const double dy = 0.25*(gy + jitter(id, sample, 1)) - 0.5;
+						cr.push_back(fract.x_min() + (px.x + dx)*sx);
+						ci.push_back(fract.y_min() + (px.y + dy)*sy);
+						owner.push_back(k);
+					}
+				}
+				if(owner.empty())
+					break;
+				out.resize(owner.size());
+				eval(cr.data(), ci.data(), static_cast<int>(owner.size()), out.data());
+				taken += owner.size();
+				// the mean of every pixel before this round, then after
+				size_t s = 0;
+				while(s < owner.size())
+				{
+					auto& px = pixels[owner[s]];
+					const int before = px.taken + 1;
+					double mean[3];
+					for(int ch = 0; ch < 3; ++ch)
+						mean[ch] = px.sum[ch]/before;
+					for(; s < owner.size() && &pixels[owner[s]] == &px; ++s)
+					{
+						const uint32_t c = out[s];
+						for(int ch = 0; ch < 3; ++ch)
+							px.sum[ch] += channel(c, ch);
+						++px.taken;
+					}
+					double moved = 0.0;
+					for(int ch = 0; ch < 3; ++ch)
+						moved = std::max(moved, std::fabs(px.sum[ch]/(px.taken + 1) - mean[ch]));
+					px.spread = moved;
+					if(moved < tolerance)
+					{
+						px.done = true;
+						++converged;
+					}
+					else if(px.taken >= max_samples)
+						px.done = true;
+				}
+			}
+			for(const auto& px : pixels)
+			{
+				uint8_t* dst = bgr.ptr<uint8_t>(px.y) + 3*px.x;
+				for(int ch = 0; ch < 3; ++ch)
+					dst[ch] = static_cast<uint8_t>(std::lround(px.sum[ch]/(px.taken + 1)));
+			}
+			n_edges += pixels.size();
+			n_samples += taken;
+			n_converged += converged;
+			n_capped += capped;
+		},
+		opts.threads,
+		opts.cancel.get()
+	);
+	stats.edges = n_edges;
+	stats.samples = n_samples;
+	stats.converged = n_converged;
+	stats.capped = n_capped;
+	stats.ms = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start
+	).count();
+	span.arg("edges", static_cast<double>(stats.edges)).arg("samples", static_cast<double>(stats.samples));
+	return stats;
+}
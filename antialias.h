@@ -0,0 +1,100 @@
+#ifndef FRACT_ANTIALIAS_H
+#define FRACT_ANTIALIAS_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "fract.h"
+#include "palette.h"
+
+namespace FRACTAL
+{
+//! @brief adaptive supersampling of the pixels on color edges
+//
+//  Nearly all aliasing sits where the color jumps between neighbours:
+//  filaments, the set boundary, narrow escape bands. Only there is a pixel
+//  resampled, the rest keep their single sample. An edge pixel takes one
+//  jittered sample and, only if that moved its color, more four at a
+//  time, one per quadrant of the pixel, until a round moves its mean
+//  color by less than the tolerance or aa_samples are taken. Edge pixels
+//  sit where the escape is slowest, a sample costs about what its pixel
+//  did: the samples of a tile may take aa_budget times the iterations of
+//  its pixels, the pixels that disagree most going first.
+//  Samples of all edge pixels of a tile go to eval in one call per round
+//  so the simd lanes stay full. Any coloring works on packed colors and
+//  a mask of the pixels to resample; the palette one below is built on
+//  it.
+struct AntiAlias
+{
+    //! @brief counts of the points (cr[k], ci[k]), k in [0, n)
+    typedef std::function<void(const double* cr, const double* ci, int n, int* out)> PointEval;
+    //! @brief packed 0x00RRGGBB colors of the points
+    typedef std::function<void(const double* cr, const double* ci, int n, uint32_t* out)> ColorEval;
+
+    struct Stats
+    {
+        size_t pixels = 0;
+        //! @brief pixels resampled, sub-pixel samples taken for them
+        size_t edges = 0;
+        size_t samples = 0;
+        //! @brief edge pixels that settled before aa_samples, that the
+        //         iteration budget stopped
+        size_t converged = 0;
+        size_t capped = 0;
+        double ms = 0.0;
+        std::string info() const;
+    };
+
+    //! @brief for every pixel whose packed color differs from one of its
+    //         eight neighbours by more than threshold in some channel the
+    //         largest difference, 0 for the others
+    static std::vector<uint8_t> edges(
+        const std::vector<uint32_t>& color,
+        const int width,
+        const int height,
+        const int threshold
+    );
+
+    //! @brief iterations a sample of every pixel is expected to take,
+    //         its count, iter_max for the interior edge pixels; the
+    //         interior elsewhere was filled, not iterated
+    static std::vector<float> costs(
+        const std::vector<int>& counts,
+        const std::vector<uint8_t>& edge,
+        const int iter_max
+    );
+
+    //! @brief resample the edge pixels of bgr, colored from counts with
+    //         palette, in the window fract; opts gives aa_samples,
+    //         aa_threshold, aa_tolerance, aa_budget, threads and tile
+    static Stats render(
+        const CS<int>& scr,
+        const CS<double>& fract,
+        const std::vector<int>& counts,
+        const int iter_max,
+        const Palette& palette,
+        const PointEval& eval,
+        cv::Mat& bgr,
+        const RenderOptions& opts
+    );
+    //! @brief resample the pixels of bgr marked in edge, the higher the
+    //         sooner, color their packed colors as rendered, cost as
+    //         costs() gives it; opts gives aa_samples, aa_tolerance,
+    //         aa_budget, threads and tile
+    static Stats render(
+        const CS<int>& scr,
+        const CS<double>& fract,
+        const std::vector<uint32_t>& color,
+        const std::vector<uint8_t>& edge,
+        const std::vector<float>& cost,
+        const ColorEval& eval,
+        cv::Mat& bgr,
+        const RenderOptions& opts
+    );
+};
+} // namespace FRACTAL
+
+#endif // FRACT_ANTIALIAS_H
@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "bigfixed.h"
+
+using namespace FRACTAL;
+
+namespace
+{
+void negateInPlace(std::vector<uint32_t>& l)
+{
+	uint64_t carry = 1;
+	for(auto& limb: l)
+	{
+		uint64_t v = uint64_t(~limb) + carry;
+		limb = uint32_t(v);
+		carry = v >> 32;
+	}
+}
+} // namespace
+
+FRACTAL::BigFixed::BigFixed(const int limbs)
+: _l(std::max(limbs, 2), 0u)
+{}
+
+int FRACTAL::BigFixed::limbsFor(const double spacing)
+{
+	// bits below the spacing keep the orbit error far under one step
+	const double bits = spacing > 0.0 ? -std::log2(spacing) : 64.0;
+	return 1 + std::max(2, int(std::ceil((std::max(bits, 0.0) + 64.0)/32.0)));
+}
+
+BigFixed FRACTAL::BigFixed::fromDouble(const double v, const int limbs)
+{
+	if(!std::isfinite(v) || std::fabs(v) >= 2147483648.0)
+		throw std::runtime_error("BigFixed::fromDouble::out of range");
+	BigFixed out(limbs);
+	double a = std::fabs(v);
+	double ip = std::floor(a);
+	out._l.back() = uint32_t(ip);
+	double f = a - ip;
+	for(int i = out.limbs() - 2; i >= 0 && f > 0.0; --i)
+	{
+		f *= 4294967296.0;
+		double limb = std::floor(f);
+		out._l[i] = uint32_t(limb);
+		f -= limb;
+	}
+	if(v < 0)
+		negateInPlace(out._l);
+	return out;
+}
+
+BigFixed FRACTAL::BigFixed::fromString(const std::string& s, const int limbs)
+{
+	size_t pos = 0;
+	bool neg = false;
+	if(pos < s.size() && (s[pos] == '-' || s[pos] == '+'))
+		neg = s[pos++] == '-';
+	std::string int_digits, frac_digits;
+	bool in_frac = false;
+	for(; pos < s.size(); ++pos)
+	{
+		char ch = s[pos];
+		if(ch == '.' && !in_frac)
+			in_frac = true;
+		else if(ch >= '0' && ch <= '9')
+			(in_frac ? frac_digits : int_digits) += ch;
+		else
+			break;
+	}
+	int exponent = 0;
+	if(pos < s.size() && (s[pos] == 'e' || s[pos] == 'E'))
+		exponent = std::stoi(s.substr(pos + 1));
+	else if(pos != s.size())
+		throw std::runtime_error("BigFixed::fromString::bad number::" + s);
+	// move the decimal point by the exponent
+	std::string digits = int_digits + frac_digits;
+	int point = int(int_digits.size()) + exponent;
+	if(point < 0)
+	{
+		digits = std::string(-point, '0') + digits;
+		point = 0;
+	}
+	if(point > int(digits.size()))
+		digits += std::string(point - digits.size(), '0');
+	uint64_t ip = 0;
+	for(int i = 0; i < point; ++i)
+	{
+		ip = ip*10 + uint64_t(digits[i] - '0');
+		if(ip > 0x7FFFFFFFu)
+			throw std::runtime_error("BigFixed::fromString::out of range::" + s);
+	}
+	// fraction by Horner from the last digit: f = (f + d)/10
+	std::vector<uint32_t> mag(std::max(limbs, 2), 0u);
+	for(int i = int(digits.size()) - 1; i >= point; --i)
+	{
+		mag.back() = uint32_t(digits[i] - '0');
+		uint64_t rem = 0;
+		for(int k = int(mag.size()) - 1; k >= 0; --k)
+		{
+			uint64_t cur = (rem << 32) | mag[k];
+			mag[k] = uint32_t(cur/10);
+			rem = cur%10;
+		}
+	}
+	mag.back() = uint32_t(ip);
+	return fromMagnitude(mag, neg);
+}
+
+std::vector<uint32_t> FRACTAL::BigFixed::magnitude() const
+{
+	auto mag = _l;
+	if(negative())
+		negateInPlace(mag);
+	return mag;
+}
+
+BigFixed FRACTAL::BigFixed::fromMagnitude(std::vector<uint32_t> mag, const bool neg)
+{
+	BigFixed out(int(mag.size()));
+	out._l = std::move(mag);
+	if(neg)
+		negateInPlace(out._l);
+	return out;
+}
+
+double FRACTAL::BigFixed::toDouble() const
+{
+	auto mag = magnitude();
+	double v = 0.0, scale = 1.0;
+	// three limbs past the integer one cover the 53 bit mantissa
+	for(int i = limbs() - 1; i >= std::max(0, limbs() - 4); --i)
+	{
+		v += double(mag[i])*scale;
+		scale /= 4294967296.0;
+	}
+	return negative() ? -v : v;
+}
+
+std::string FRACTAL::BigFixed::toString(int digits) const
+{
+	if(digits < 0)
+		digits = int(std::ceil(32.0*(limbs() - 1)*0.30103));
+	auto mag = magnitude();
+	std::string out = negative() ? "-" : "";
+	out += std::to_string(mag.back());
+	out += '.';
+	mag.back() = 0;
+	for(int d = 0; d < digits; ++d)
+	{
+		uint64_t carry = 0;
+		for(int k = 0; k < limbs() - 1; ++k)
+		{
+			uint64_t cur = uint64_t(mag[k])*10 + carry;
+			mag[k] = uint32_t(cur);
+			carry = cur >> 32;
+		}
+		out += char('0' + carry);
+	}
+	return out;
+}
+
+BigFixed FRACTAL::BigFixed::withLimbs(const int limbs) const
+{
+	BigFixed out(limbs);
+	const int diff = out.limbs() - this->limbs();
+	if(diff >= 0)
+		std::copy(_l.begin(), _l.end(), out._l.begin() + diff);
+	else
+		std::copy(_l.begin() - diff, _l.end(), out._l.begin());
+	return out;
+}
+
+BigFixed FRACTAL::BigFixed::operator-() const
+{
+	BigFixed out(*this);
+	negateInPlace(out._l);
+	return out;
+}
+
+BigFixed FRACTAL::BigFixed::operator+(const BigFixed& o) const
+{
+	if(o.limbs() != limbs())
+	{
+		const int n = std::max(limbs(), o.limbs());
+		return withLimbs(n) + o.withLimbs(n);
+	}
+	BigFixed out(limbs());
+	uint64_t carry = 0;
+	for(int i = 0; i < limbs(); ++i)
+	{
+		uint64_t v = uint64_t(_l[i]) + o._l[i] + carry;
+		out._l[i] = uint32_t(v);
+		carry = v >> 32;
+	}
+	return out;
+}
+
+BigFixed FRACTAL::BigFixed::operator-(const BigFixed& o) const
+{
+	return *this + (-o);
+}
+
+BigFixed FRACTAL::BigFixed::operator*(const BigFixed& o) const
+{
+	if(o.limbs() != limbs())
+	{
+		const int n = std::max(limbs(), o.limbs());
+		return withLimbs(n)*o.withLimbs(n);
+	}
+	const int n = limbs();
+	auto a = magnitude(), b = o.magnitude();
+	std::vector<uint32_t> prod(2*n, 0u);
+	for(int i = 0; i < n; ++i)
+	{
+		if(a[i] == 0)
+			continue;
+		uint64_t carry = 0;
+		for(int j = 0; j < n; ++j)
+		{
+			uint64_t cur = uint64_t(a[i])*b[j] + prod[i + j] + carry;
+			prod[i + j] = uint32_t(cur);
+			carry = cur >> 32;
+		}
+		prod[i + n] = uint32_t(carry);
+	}
+	// drop the n-1 extra fraction limbs of the product
+	std::vector<uint32_t> mag(prod.begin() + (n - 1), prod.begin() + (2*n - 1));
+	return fromMagnitude(mag, negative() != o.negative());
+}
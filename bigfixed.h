@@ -0,0 +1,48 @@
+#ifndef FRACT_BIGFIXED_H
+#define FRACT_BIGFIXED_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace FRACTAL
+{
+//! @brief arbitrary precision signed fixed point number
+//
+//  Two's complement over 32-bit limbs, least significant first. The top
+//  limb is the integer part, the others are the fraction, so a number with
+//  n limbs has 32*(n-1) fractional bits. Enough for coordinates and
+//  reference orbits, where |z| stays small.
+class BigFixed
+{
+public:
+    explicit BigFixed(const int limbs = 4);
+    static BigFixed fromDouble(const double v, const int limbs);
+    //! @brief parse "-0.7486919505900001234", exponents "1.5e-20" allowed
+    static BigFixed fromString(const std::string& s, const int limbs);
+    //! @brief limbs needed to resolve a step of the given size with margin
+    static int limbsFor(const double spacing);
+
+    double toDouble() const;
+    //! @brief decimal form, digits < 0 prints all significant fraction digits
+    std::string toString(int digits = -1) const;
+    int limbs() const { return static_cast<int>(_l.size()); }
+    bool negative() const { return (_l.back() & 0x80000000u) != 0; }
+    //! @brief same value with another precision, extra limbs are zero
+    BigFixed withLimbs(const int limbs) const;
+
+    BigFixed operator-() const;
+    BigFixed operator+(const BigFixed& o) const;
+    BigFixed operator-(const BigFixed& o) const;
+    BigFixed operator*(const BigFixed& o) const;
+    BigFixed operator+(const double o) const { return *this + fromDouble(o, limbs()); }
+    BigFixed& operator+=(const BigFixed& o) { return *this = *this + o; }
+
+private:
+    std::vector<uint32_t> _l;
+    std::vector<uint32_t> magnitude() const;
+    static BigFixed fromMagnitude(std::vector<uint32_t> mag, const bool neg);
+};
+} // namespace FRACTAL
+
+#endif // FRACT_BIGFIXED_H
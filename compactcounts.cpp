@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "compactcounts.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+namespace
+{
+//! @brief shortest run worth a run token: a run of 2 costs as much as
+//         two literals
+const int MIN_RUN = 3;
+
+void putVarint(uint32_t v, std::vector<uint8_t>& out)
+{
+	while(v >= 0x80)
+	{
+		out.push_back(static_cast<uint8_t>(v | 0x80));
+		v >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(v));
+}
+
+bool getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& v)
+{
+	v = 0;
+	for(int shift = 0; shift < 35 && p < end; shift += 7)
+	{
+		const uint8_t b = *p++;
+		v |= static_cast<uint32_t>(b & 0x7F) << shift;
+		if(!(b & 0x80))
+			return true;
+	}
+	return false;
+}
+} // namespace
+
+FRACTAL::CompactCounts::CompactCounts(
+	const std::vector<int>& counts,
+	const int width,
+	const int height,
+	const int iter_max
+)
+: _width(width)
+, _height(height)
+, _iter_max(iter_max)
+{
+	if(!fits(iter_max))
+		throw std::runtime_error("CompactCounts: iter_max does not fit in 16 bits");
+	const size_t n = static_cast<size_t>(width)*height;
+	if(counts.size() != n)
+		throw std::runtime_error("CompactCounts: buffer size does not match the frame");
+	_counts.resize(n);
+	for(size_t k = 0; k < n; ++k)
+		_counts[k] = static_cast<uint16_t>(std::min(std::max(counts[k], 0), iter_max));
+	_interior.assign((n + 63)/64, 0);
+	for(size_t k = 0; k < n; ++k)
+	{
+		if(counts[k] >= iter_max)
+			_interior[k >> 6] |= uint64_t(1) << (k & 63);
+	}
+}
+
+void FRACTAL::CompactCounts::packTile(
+	const int* counts,
+	const int width,
+	const int height,
+	const int stride,
+	std::vector<uint8_t>& packed
+)
+{
+	packed.clear();
+	const size_t n = static_cast<size_t>(width)*height;
+	// the block in one row, coded as a single sequence
+	thread_local std::vector<uint32_t> flat;
+	flat.resize(n);
+	for(int y = 0; y < height; ++y)
+	{
+		for(int x = 0; x < width; ++x)
+			flat[static_cast<size_t>(y)*width + x] = static_cast<uint32_t>(std::max(counts[y*stride + x], 0));
+	}
+	auto at = [&](const size_t k) -> uint32_t { return flat[k]; };
+	// token = length << 1 | 1 then the value for a run, length << 1 then
+	// length values for literals
+	size_t k = 0, literal = 0;
+	auto flush = [&](const size_t end) -> void
+	{
+		if(literal == end)
+			return;
+		putVarint(static_cast<uint32_t>((end - literal) << 1), packed);
+		for(size_t j = literal; j < end; ++j)
+			putVarint(at(j), packed);
+	};
+	while(k < n)
+	{
+		const uint32_t v = at(k);
+		size_t run = 1;
+		while(k + run < n && at(k + run) == v)
+			++run;
+		if(run >= MIN_RUN)
+		{
+			flush(k);
+			putVarint(static_cast<uint32_t>(run << 1 | 1), packed);
+			putVarint(v, packed);
+			k += run;
+			literal = k;
+		}
+		else
+			k += run;
+	}
+	flush(n);
+}
+
+bool FRACTAL::CompactCounts::unpackTile(
+	const uint8_t* packed,
+	const size_t size,
+	const int width,
+	const int height,
+	int* out,
+	const int stride
+)
+{
+	const uint8_t* p = packed;
+	const uint8_t* end = packed + size;
+	const size_t n = static_cast<size_t>(width)*height;
+	size_t k = 0;
+	int x = 0;
+	int* row = out;
+	auto put = [&](const uint32_t v) -> void
+	{
+		row[x] = static_cast<int>(v);
+		++k;
+		if(++x == width)
+		{
+			x = 0;
+			row += stride;
+		}
+	};
+	while(p < end)
+	{
+		uint32_t token = 0, v = 0;
+		if(!getVarint(p, end, token))
+			return false;
+		const size_t length = token >> 1;
+		if(length == 0 || k + length > n)
+			return false;
+		if(token & 1)
+		{
+			if(!getVarint(p, end, v))
+				return false;
+			for(size_t j = 0; j < length; ++j)
+				put(v);
+		}
+		else
+		{
+			for(size_t j = 0; j < length; ++j)
+			{
+				if(!getVarint(p, end, v))
+					return false;
+				put(v);
+			}
+		}
+	}
+	return k == n;
+}
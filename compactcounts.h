@@ -0,0 +1,70 @@
+#ifndef FRACT_COMPACTCOUNTS_H
+#define FRACT_COMPACTCOUNTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FRACTAL
+{
+//! @brief escape counts of a frame in 16 bits plus an interior bitmask
+//
+//  Counts never exceed iter_max, so below 65536 iterations they fit in a
+//  uint16_t: half the bytes of the int buffer a frame renders into, and
+//  half the memory read when it is colored. The interior (count ==
+//  iter_max) is also kept as one bit per pixel, the mask of a COMPACT
+//  dump (iterdump.h).
+class CompactCounts
+{
+public:
+    static bool fits(const int iter_max) { return iter_max >= 0 && iter_max <= 0xFFFF; }
+
+    CompactCounts() = default;
+    //! @brief counts of a width x height frame, row by row; throws unless
+    //         fits(iter_max)
+    CompactCounts(
+        const std::vector<int>& counts,
+        const int width,
+        const int height,
+        const int iter_max
+    );
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+    int iterMax() const { return _iter_max; }
+    const uint16_t* counts() const { return _counts.data(); }
+    //! @brief bit k & 63 of word k >> 6 is set for an interior pixel k,
+    //         (width*height + 63)/64 words
+    const uint64_t* interior() const { return _interior.data(); }
+
+    //! @brief a width x height block of counts (rows stride ints apart)
+    //         coded for a cache or an archive: runs of one value and
+    //         literal stretches, lengths and values as LEB128 varints. An
+    //         interior or smooth exterior tile packs to a few bytes, a
+    //         boundary tile to about one byte per count under 128
+    static void packTile(
+        const int* counts,
+        const int width,
+        const int height,
+        const int stride,
+        std::vector<uint8_t>& packed
+    );
+    //! @brief inverse of packTile; false, out partly written, on data
+    //         that does not decode to exactly width x height counts
+    static bool unpackTile(
+        const uint8_t* packed,
+        const size_t size,
+        const int width,
+        const int height,
+        int* out,
+        const int stride
+    );
+
+private:
+    int _width = 0, _height = 0, _iter_max = 0;
+    std::vector<uint16_t> _counts;
+    std::vector<uint64_t> _interior;
+};
+} // namespace FRACTAL
+
+#endif // FRACT_COMPACTCOUNTS_H
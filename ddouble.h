@@ -0,0 +1,135 @@
+#ifndef FRACT_DDOUBLE_H
+#define FRACT_DDOUBLE_H
+
+#include <cmath>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+namespace FRACTAL
+{
+//! @brief double-double real: hi + lo with |lo| <= ulp(hi)/2, about 106 bits
+//
+//  Error-free transforms after Dekker/Knuth. Much faster than BigFixed and
+//  enough for windows down to ~1e-30; plugs into CS<T>, CSHelper::scale
+//  and formula::escape as the real type.
+struct DDouble
+{
+    double hi = 0.0, lo = 0.0;
+
+    DDouble() {}
+    DDouble(const double v) : hi(v), lo(0.0) {}
+    DDouble(const double hi_, const double lo_) : hi(hi_), lo(lo_) {}
+    explicit operator double() const { return hi + lo; }
+
+    static DDouble twoSum(const double a, const double b)
+    {
+        const double s = a + b;
+        const double bb = s - a;
+        return DDouble(s, (a - (s - bb)) + (b - bb));
+    }
+    //! @brief twoSum for |a| >= |b|
+    static DDouble quickTwoSum(const double a, const double b)
+    {
+        const double s = a + b;
+        return DDouble(s, b - (s - a));
+    }
+    static DDouble twoProd(const double a, const double b)
+    {
+        const double p = a*b;
+#ifdef FP_FAST_FMA
+        return DDouble(p, std::fma(a, b, -p));
+#else
+        double ahi, alo, bhi, blo;
+        split(a, ahi, alo);
+        split(b, bhi, blo);
+        return DDouble(p, ((ahi*bhi - p) + ahi*blo + alo*bhi) + alo*blo);
+#endif
+    }
+    static void split(const double a, double& hi, double& lo)
+    {
+        const double t = 134217729.0*a; // 2^27 + 1
+        hi = t - (t - a);
+        lo = a - hi;
+    }
+
+    DDouble operator-() const { return DDouble(-hi, -lo); }
+    DDouble& operator+=(const DDouble& o) { return *this = *this + o; }
+    DDouble& operator-=(const DDouble& o) { return *this = *this - o; }
+    DDouble& operator*=(const DDouble& o) { return *this = *this * o; }
+    DDouble& operator/=(const DDouble& o) { return *this = *this / o; }
+
+    friend DDouble operator+(const DDouble& a, const DDouble& b)
+    {
+        DDouble s = twoSum(a.hi, b.hi);
+        const DDouble t = twoSum(a.lo, b.lo);
+        s.lo += t.hi;
+        s = quickTwoSum(s.hi, s.lo);
+        s.lo += t.lo;
+        return quickTwoSum(s.hi, s.lo);
+    }
+    friend DDouble operator+(const DDouble& a, const double b)
+    {
+        DDouble s = twoSum(a.hi, b);
+        s.lo += a.lo;
+        return quickTwoSum(s.hi, s.lo);
+    }
+    friend DDouble operator+(const double a, const DDouble& b) { return b + a; }
+    friend DDouble operator-(const DDouble& a, const DDouble& b) { return a + (-b); }
+    friend DDouble operator-(const DDouble& a, const double b) { return a + (-b); }
+    friend DDouble operator-(const double a, const DDouble& b) { return (-b) + a; }
+    friend DDouble operator*(const DDouble& a, const DDouble& b)
+    {
+        DDouble p = twoProd(a.hi, b.hi);
+        p.lo += a.hi*b.lo + a.lo*b.hi;
+        return quickTwoSum(p.hi, p.lo);
+    }
+    friend DDouble operator*(const DDouble& a, const double b)
+    {
+        DDouble p = twoProd(a.hi, b);
+        p.lo += a.lo*b;
+        return quickTwoSum(p.hi, p.lo);
+    }
+    friend DDouble operator*(const double a, const DDouble& b) { return b*a; }
+    friend DDouble operator/(const DDouble& a, const DDouble& b)
+    {
+        const double q1 = a.hi / b.hi;
+        DDouble r = a - b*q1;
+        const double q2 = r.hi / b.hi;
+        r -= b*q2;
+        const double q3 = r.hi / b.hi;
+        return quickTwoSum(q1, q2) + q3;
+    }
+    friend DDouble operator/(const DDouble& a, const double b) { return a / DDouble(b); }
+    friend DDouble operator/(const double a, const DDouble& b) { return DDouble(a) / b; }
+
+    friend bool operator<(const DDouble& a, const DDouble& b) { return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo); }
+    friend bool operator>(const DDouble& a, const DDouble& b) { return b < a; }
+    friend bool operator<=(const DDouble& a, const DDouble& b) { return !(b < a); }
+    friend bool operator>=(const DDouble& a, const DDouble& b) { return !(a < b); }
+    friend bool operator==(const DDouble& a, const DDouble& b) { return a.hi == b.hi && a.lo == b.lo; }
+    friend bool operator!=(const DDouble& a, const DDouble& b) { return !(a == b); }
+
+    std::string info() const { return cv::format("%.17g%+.17g", hi, lo); }
+};
+
+inline DDouble abs(const DDouble& a) { return a.hi < 0.0 ? -a : a; }
+
+//! @brief complex number over DDouble, std::complex is only defined for
+//         the built-in floating types
+struct DDComplex
+{
+    DDComplex() {}
+    DDComplex(const DDouble& re_, const DDouble& im_) : re(re_), im(im_) {}
+    DDouble re, im;
+    DDouble norm() const { return re*re + im*im; }
+    friend DDComplex operator+(const DDComplex& a, const DDComplex& b) { return {a.re + b.re, a.im + b.im}; }
+    friend DDComplex operator-(const DDComplex& a, const DDComplex& b) { return {a.re - b.re, a.im - b.im}; }
+    friend DDComplex operator*(const DDComplex& a, const DDComplex& b)
+    {
+        return {a.re*b.re - a.im*b.im, a.re*b.im + a.im*b.re};
+    }
+};
+} // namespace FRACTAL
+
+#endif // FRACT_DDOUBLE_H
@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#include "distance.h"
+#include "kernels.h"
+#include "scheduler.h"
+#include "trace.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+namespace
+{
+//! @brief the boundary can cross a pixel whose center is closer than half
+//         its diagonal
+const float PIXEL_REACH = 0.70710678f;
+
+struct Block
+{
+	int x, y, width, height;
+};
+} // namespace
+
+std::string FRACTAL::DistanceEstimate::Stats::info() const
+{
+	return cv::format(
+		"DistanceEstimate::iterated %.1f%%, filled %.1f%%, %.1f ms",
+		pixels ? 100.0*evaluated/pixels : 0.0,
+		pixels ? 100.0*filled/pixels : 0.0,
+		ms
+	);
+}
+
+DistanceEstimate::Stats FRACTAL::DistanceEstimate::render(
+	const CS<int>& scr,
+	const CS<double>& fract,
+	const int iter_max,
+	std::vector<int>& counts,
+	std::vector<float>& distance,
+	const RenderOptions& opts
+)
+{
+	Trace::Span span("distance");
+	auto start = std::chrono::steady_clock::now();
+	Stats stats;
+	const int width = scr.width(), height = scr.height();
+	stats.pixels = static_cast<size_t>(width)*height;
+	counts.resize(stats.pixels);
+	distance.assign(stats.pixels, 0.0f);
+	const double spacing = fract.width()/width;
+	std::vector<double> cx(width), cy(height);
+	for(int x = 0; x < width; ++x)
+		cx[x] = fract.x_min() + x*spacing;
+	for(int y = 0; y < height; ++y)
+		cy[y] = fract.y_min() + y*(fract.height()/height);
+	const double tol = kernels::periodicityTol(spacing);
+	const double thickness = opts.de_thickness;
+	// the bound of an iterated pixel is at least a quarter of its true
+	// distance: a filled pixel 4 thickness away shades white either way
+	const double fill_min = 4.0*thickness;
+	const bool fill = opts.de_fill;
+	const bool interior = opts.subdivide;
+	const int trace_min = std::max(3, opts.subdivide_min);
+	// every pixel of the border of b is in the set
+	auto inside = [&](const Block& b) -> bool
+	{
+		for(int x = b.x; x < b.x + b.width; ++x)
+		{
+			if(counts[b.y*width + x] < iter_max || counts[(b.y + b.height - 1)*width + x] < iter_max)
+				return false;
+		}
+		for(int y = b.y + 1; y < b.y + b.height - 1; ++y)
+		{
+			if(counts[y*width + b.x] < iter_max || counts[y*width + b.x + b.width - 1] < iter_max)
+				return false;
+		}
+		return true;
+	};
+
+	const cv::Rect rc(0, 0, width, height);
+	const auto symmetry = Fract::symmetryOf<formula::Mandelbrot>(scr, fract, opts);
+	const cv::Rect mirrored = symmetry.mirrored(rc);
+	// a pixel is iterated once: tiles touch only their own pixels
+	std::vector<uint8_t> known(stats.pixels, 0);
+	std::atomic<size_t> evaluated(0), filled(0);
+	Scheduler::run(
+		Symmetry::subtract(Scheduler::tiles(rc, opts.tile), mirrored),
+		std::vector<double>(),
+		[&](const cv::Rect& tile, const size_t) -> void
+		{
+			Trace::Span span("tile");
+			std::vector<Block> blocks{{tile.x, tile.y, tile.width, tile.height}}, next;
+			std::vector<double> pr, pi, de;
+			std::vector<int> ps, out;
+			size_t n_evaluated = 0, n_filled = 0;
+			auto need = [&](const int p) -> void
+			{
+				if(known[p])
+					return;
+				known[p] = 1;
+				ps.push_back(p);
+			};
+			// the pixels of a level in one call, the simd lanes full
+			auto evaluate = [&]() -> void
+			{
+				const int n = static_cast<int>(ps.size());
+				pr.resize(n);
+				pi.resize(n);
+				out.resize(n);
+				de.resize(n);
+				for(int k = 0; k < n; ++k)
+				{
+					pr[k] = cx[ps[k] % width];
+					pi[k] = cy[ps[k]/width];
+				}
+				kernels::mandelbrotDistance(pr.data(), pi.data(), n, iter_max, out.data(), de.data(), tol);
+				for(int k = 0; k < n; ++k)
+				{
+					counts[ps[k]] = out[k];
+					distance[ps[k]] = static_cast<float>(de[k]/spacing);
+				}
+				n_evaluated += n;
+				ps.clear();
+			};
+			auto traced = [&](const Block& b) -> bool
+			{
+				return interior && counts[b.y*width + b.x] >= iter_max
+					&& std::min(b.width, b.height) >= trace_min;
+			};
+			while(!blocks.empty())
+			{
+				for(const auto& b : blocks)
+					need(b.y*width + b.x);
+				evaluate();
+				// the set has no holes: a block bordered by the set is in it
+				for(const auto& b : blocks)
+				{
+					if(!traced(b))
+						continue;
+					for(int x = b.x; x < b.x + b.width; ++x)
+					{
+						need(b.y*width + x);
+						need((b.y + b.height - 1)*width + x);
+					}
+					for(int y = b.y + 1; y < b.y + b.height - 1; ++y)
+					{
+						need(y*width + b.x);
+						need(y*width + b.x + b.width - 1);
+					}
+				}
+				evaluate();
+				next.clear();
+				for(const auto& b : blocks)
+				{
+					const int p = b.y*width + b.x;
+					if(b.width == 1 && b.height == 1)
+						continue;
+					// no pixel of the block is nearer the set than this
+					const float corner = distance[p];
+					const float bound = corner - static_cast<float>(
+						std::hypot(b.width - 1.0, b.height - 1.0)
+					);
+					if(fill && counts[p] < iter_max && bound >= fill_min)
+					{
+						const int count = counts[p];
+						for(int y = b.y; y < b.y + b.height; ++y)
+						{
+							std::fill_n(&counts[y*width + b.x], b.width, count);
+							std::fill_n(&distance[y*width + b.x], b.width, bound);
+						}
+						distance[p] = corner;
+						n_filled += static_cast<size_t>(b.width)*b.height - 1;
+						continue;
+					}
+					if(traced(b) && inside(b))
+					{
+						// distance stays 0
+						for(int y = b.y + 1; y < b.y + b.height - 1; ++y)
+							std::fill_n(&counts[y*width + b.x + 1], b.width - 2, iter_max);
+						n_filled += static_cast<size_t>(b.width - 2)*(b.height - 2);
+						continue;
+					}
+					const int w0 = (b.width + 1)/2, h0 = (b.height + 1)/2;
+					const Block quarters[4] = {
+						{b.x, b.y, w0, h0},
+						{b.x + w0, b.y, b.width - w0, h0},
+						{b.x, b.y + h0, w0, b.height - h0},
+						{b.x + w0, b.y + h0, b.width - w0, b.height - h0}
+					};
+					for(const auto& q : quarters)
+					{
+						if(q.width > 0 && q.height > 0)
+							next.push_back(q);
+					}
+				}
+				blocks.swap(next);
+			}
+			evaluated += n_evaluated;
+			filled += n_filled;
+			span.arg("pixels", static_cast<double>(n_evaluated)).arg("filled", static_cast<double>(n_filled));
+		},
+		opts.threads,
+		opts.cancel.get()
+	);
+	if(!mirrored.empty() && !opts.cancelled())
+	{
+		symmetry.copy(counts, width, mirrored);
+		symmetry.copy(distance, width, mirrored);
+	}
+	stats.evaluated = evaluated;
+	stats.filled = filled;
+	stats.ms = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start
+	).count();
+	span.arg("pixels", static_cast<double>(stats.evaluated)).arg("filled", static_cast<double>(stats.filled));
+	return stats;
+}
+
+uint32_t FRACTAL::DistanceEstimate::shade(
+	const int count,
+	const float distance,
+	const int iter_max,
+	const double thickness
+)
+{
+	if(count >= iter_max)
+		return 0;
+	const double t = thickness > 0.0 ? std::min(1.0, distance/thickness) : 1.0;
+	return 0x010101u*static_cast<uint32_t>(std::lround(255.0*std::max(t, 0.0)));
+}
+
+void FRACTAL::DistanceEstimate::colorize(
+	const std::vector<int>& counts,
+	const std::vector<float>& distance,
+	const int width,
+	const int height,
+	const int iter_max,
+	const double thickness,
+	cv::Mat& bgr
+)
+{
+	bgr.create(height, width, CV_8UC3);
+	cv::parallel_for_(
+		cv::Range(0, height),
+		[&](const cv::Range& rows) -> void
+		{
+			for(int y = rows.start; y < rows.end; ++y)
+			{
+				uint8_t* dst = bgr.ptr<uint8_t>(y);
+				for(int x = 0; x < width; ++x)
+				{
+					const size_t p = static_cast<size_t>(y)*width + x;
+					const uint8_t g = static_cast<uint8_t>(shade(counts[p], distance[p], iter_max, thickness));
+					dst[3*x] = dst[3*x + 1] = dst[3*x + 2] = g;
+				}
+			}
+		}
+	);
+}
+
+AntiAlias::Stats FRACTAL::DistanceEstimate::antiAlias(
+	const CS<int>& scr,
+	const CS<double>& fract,
+	const std::vector<int>& counts,
+	const std::vector<float>& distance,
+	const int iter_max,
+	cv::Mat& bgr,
+	const RenderOptions& opts
+)
+{
+	const int width = scr.width(), height = scr.height();
+	const size_t pixels = static_cast<size_t>(width)*height;
+	if(opts.aa_samples < 1 || counts.size() != pixels || distance.size() != pixels)
+	{
+		AntiAlias::Stats stats;
+		stats.pixels = pixels;
+		return stats;
+	}
+	const double thickness = opts.de_thickness;
+	std::vector<uint32_t> color(pixels);
+	for(size_t p = 0; p < pixels; ++p)
+		color[p] = shade(counts[p], distance[p], iter_max, thickness);
+	auto edge = AntiAlias::edges(color, width, height, opts.aa_threshold);
+	for(size_t p = 0; p < pixels; ++p)
+		if(counts[p] < iter_max && distance[p] < PIXEL_REACH)
+			edge[p] = std::max<uint8_t>(edge[p], 1);
+	const double spacing = fract.width()/width;
+	const double tol = kernels::periodicityTol(spacing);
+	return AntiAlias::render(
+		scr,
+		fract,
+		color,
+		edge,
+		AntiAlias::costs(counts, edge, iter_max),
+		[iter_max, thickness, spacing, tol](const double* cr, const double* ci, int n, uint32_t* out) -> void
+		{
+			thread_local std::vector<int> counts;
+			thread_local std::vector<double> de;
+			counts.resize(n);
+			de.resize(n);
+			kernels::mandelbrotDistance(cr, ci, n, iter_max, counts.data(), de.data(), tol);
+			for(int k = 0; k < n; ++k)
+				out[k] = shade(counts[k], static_cast<float>(de[k]/spacing), iter_max, thickness);
+		},
+		bgr,
+		opts
+	);
+}
@@ -0,0 +1,94 @@
+#ifndef FRACT_DISTANCE_H
+#define FRACT_DISTANCE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "antialias.h"
+#include "fract.h"
+
+namespace FRACTAL
+{
+//! @brief exterior distance estimation of the Mandelbrot set
+//
+//  Next to its count every sample gets a lower bound of its distance to
+//  the set from the derivative of its orbit (kernels::mandelbrotDistance).
+//  Shaded by that distance the boundary and its filaments are sharp lines
+//  whatever iter_max, without the bands of the counts. The bound holds for
+//  the pixels around the sample too: a tile is walked as a quadtree of
+//  blocks, a block whose corner is further from the set than 4 de_thickness
+//  plus the reach of the corner across the block is filled from it, the
+//  others are split in four, down to single pixels. The bound is at least
+//  a quarter of the true distance, so a filled pixel shades as it would
+//  iterated; its count is the corner's. The interior
+//  has no distance: a block whose corner is in the set has its border
+//  traced, and one bordered by the set all around is in it, the set has
+//  no holes; the kernels' cardioid, bulb and periodicity checks cut the
+//  cost of the interior pixels still iterated.
+struct DistanceEstimate
+{
+    struct Stats
+    {
+        size_t pixels = 0;
+        //! @brief pixels iterated, pixels filled without it
+        size_t evaluated = 0;
+        size_t filled = 0;
+        double ms = 0.0;
+        std::string info() const;
+    };
+
+    //! @brief counts and distances in pixels (0 inside the set) of the
+    //         window fract, both scr.width() x scr.height() row by row;
+    //         opts gives de_fill, de_thickness, subdivide (the interior
+    //         blocks), subdivide_min, symmetry, threads, tile and cancel
+    static Stats render(
+        const CS<int>& scr,
+        const CS<double>& fract,
+        const int iter_max,
+        std::vector<int>& counts,
+        std::vector<float>& distance,
+        const RenderOptions& opts
+    );
+
+    //! @brief packed gray of a pixel: black inside the set and on its
+    //         boundary, white from thickness pixels away
+    static uint32_t shade(
+        const int count,
+        const float distance,
+        const int iter_max,
+        const double thickness
+    );
+
+    //! @brief shade of every pixel into bgr, (re)allocated as
+    //         height x width CV_8UC3
+    static void colorize(
+        const std::vector<int>& counts,
+        const std::vector<float>& distance,
+        const int width,
+        const int height,
+        const int iter_max,
+        const double thickness,
+        cv::Mat& bgr
+    );
+
+    //! @brief resample (antialias.h) the pixels of a colorized bgr whose
+    //         shade differs from a neighbour's and those the boundary may
+    //         pass through, which a filament thinner than a pixel leaves
+    //         looking like their neighbours; nothing if opts.aa_samples
+    //         is 0
+    static AntiAlias::Stats antiAlias(
+        const CS<int>& scr,
+        const CS<double>& fract,
+        const std::vector<int>& counts,
+        const std::vector<float>& distance,
+        const int iter_max,
+        cv::Mat& bgr,
+        const RenderOptions& opts
+    );
+};
+} // namespace FRACTAL
+
+#endif // FRACT_DISTANCE_H
@@ -0,0 +1,235 @@
+#ifndef FRACT_FORMULA_H
+#define FRACT_FORMULA_H
+
+#include <cmath>
+#include <type_traits>
+
+namespace FRACTAL
+{
+//! @brief compile-time formulas for the escape-time loop
+//
+//  A formula is a functor derived from formula::Formula with
+//      init(px, py, zr, zi, cr, ci) - orbit start for the sample point (px, py)
+//      step(zr, zi, cr, ci)         - one iteration, z = f(z, c)
+//  templated on the real type T so the same formula runs on double and
+//  on the extended precision types. Passing it as a template parameter
+//  lets the compiler inline and unroll step(), unlike std::function.
+//  The symmetry flags tell the renderer which pixels mirror others
+//  (symmetry.h); a formula that sets none is rendered whole.
+namespace formula
+{
+//! @brief ids of the built-in formulas, stored next to rendered data
+enum Id
+{
+    CUSTOM = 0,
+    MANDELBROT = 1,
+    BURNING_SHIP = 2,
+    TRICORN = 3,
+    MULTIBROT = 16,  // + power
+    JULIA = 1024     // + id of the wrapped formula
+};
+
+struct Formula
+{
+    //! @brief conj(f(z, c)) = f(conj(z), conj(c)): the set is symmetric
+    //         about the real axis
+    static constexpr bool conjugate_symmetric = false;
+    //! @brief f(-z, c) = f(z, c): its Julia sets are symmetric about 0
+    static constexpr bool even_step = false;
+    //! @brief the image of the sample points p and -p is the same
+    static constexpr bool point_symmetric = false;
+    //! @brief the set and its escape-time bands are connected and the set
+    //         has no holes, so a uniform rectangle border holds the same
+    //         count inside (subdivide.h); Julia sets depend on c, unknown
+    //         at compile time
+    static constexpr bool connected = false;
+    //! @brief escape() may stop orbits that return to a Brent checkpoint,
+    //         only for formulas whose counts were checked unchanged by it
+    static constexpr bool periodic = false;
+    //! @brief analytic interior test on the orbit constant, none by default
+    template <typename T>
+    bool interior(const T&, const T&) const { return false; }
+};
+
+template <typename F>
+struct IsFormula : std::is_base_of<Formula, F> {};
+
+//! @brief z*z + c
+struct Mandelbrot : Formula
+{
+    static constexpr int id = MANDELBROT;
+    static constexpr bool conjugate_symmetric = true;
+    static constexpr bool even_step = true;
+    static constexpr bool connected = true;
+    static constexpr bool periodic = true;
+    template <typename T>
+    void init(const T& px, const T& py, T& zr, T& zi, T& cr, T& ci) const
+    {
+        zr = T(0);
+        zi = T(0);
+        cr = px;
+        ci = py;
+    }
+    template <typename T>
+    void step(T& zr, T& zi, const T& cr, const T& ci) const
+    {
+        const T zr2 = zr*zr, zi2 = zi*zi;
+        zi = (zr + zr)*zi + ci;
+        zr = zr2 - zi2 + cr;
+    }
+    //! @brief c in the main cardioid or the period-2 bulb
+    template <typename T>
+    bool interior(const T& cr, const T& ci) const
+    {
+        const T xq = cr - 0.25, y2 = ci*ci;
+        const T q = xq*xq + y2;
+        const T xb = cr + 1.0;
+        return q*(q + xq) < y2*0.25 || xb*xb + y2 < T(0.0625);
+    }
+};
+
+//! @brief z^N + c, N is unrolled by the compiler
+template <int N>
+struct Multibrot : Formula
+{
+    static_assert(N >= 2, "Multibrot power must be at least 2");
+    static constexpr int id = MULTIBROT + N;
+    static constexpr bool conjugate_symmetric = true;
+    static constexpr bool connected = true;
+    static constexpr bool even_step = N % 2 == 0;
+    template <typename T>
+    void init(const T& px, const T& py, T& zr, T& zi, T& cr, T& ci) const
+    {
+        Mandelbrot().init(px, py, zr, zi, cr, ci);
+    }
+    template <typename T>
+    void step(T& zr, T& zi, const T& cr, const T& ci) const
+    {
+        T pr = zr, pi = zi;
+        for(int k = 1; k < N; ++k)
+        {
+            const T r = pr*zr - pi*zi;
+            pi = pr*zi + pi*zr;
+            pr = r;
+        }
+        zr = pr + cr;
+        zi = pi + ci;
+    }
+};
+
+//! @brief (|Re z| + i|Im z|)^2 + c
+struct BurningShip : Formula
+{
+    static constexpr int id = BURNING_SHIP;
+    static constexpr bool even_step = true;
+    template <typename T>
+    void init(const T& px, const T& py, T& zr, T& zi, T& cr, T& ci) const
+    {
+        Mandelbrot().init(px, py, zr, zi, cr, ci);
+    }
+    template <typename T>
+    void step(T& zr, T& zi, const T& cr, const T& ci) const
+    {
+        using std::abs;
+        const T ar = abs(zr), ai = abs(zi);
+        const T zr2 = ar*ar, zi2 = ai*ai;
+        zi = (ar + ar)*ai + ci;
+        zr = zr2 - zi2 + cr;
+    }
+};
+
+//! @brief conj(z)^2 + c
+struct Tricorn : Formula
+{
+    static constexpr int id = TRICORN;
+    static constexpr bool conjugate_symmetric = true;
+    static constexpr bool even_step = true;
+    template <typename T>
+    void init(const T& px, const T& py, T& zr, T& zi, T& cr, T& ci) const
+    {
+        Mandelbrot().init(px, py, zr, zi, cr, ci);
+    }
+    template <typename T>
+    void step(T& zr, T& zi, const T& cr, const T& ci) const
+    {
+        const T zr2 = zr*zr, zi2 = zi*zi;
+        zi = ci - (zr + zr)*zi;
+        zr = zr2 - zi2 + cr;
+    }
+};
+
+//! @brief Julia set of any formula above: the sample point is z0 and
+//         c is fixed to (kr, ki)
+template <typename F>
+struct Julia : Formula
+{
+    static constexpr int id = JULIA + F::id;
+    //! @brief conjugate only for a real constant, not known at compile time
+    static constexpr bool point_symmetric = F::even_step;
+    Julia(const double kr_, const double ki_, const F& f_ = F())
+    : kr(kr_)
+    , ki(ki_)
+    , f(f_)
+    {}
+    double kr, ki;
+    F f;
+    template <typename T>
+    void init(const T& px, const T& py, T& zr, T& zi, T& cr, T& ci) const
+    {
+        zr = px;
+        zi = py;
+        cr = T(kr);
+        ci = T(ki);
+    }
+    template <typename T>
+    void step(T& zr, T& zi, const T& cr, const T& ci) const
+    {
+        f.step(zr, zi, cr, ci);
+    }
+};
+
+//! @brief number of iterations until |z| >= th, at most iter_max;
+//         counts match Fract::escape with the same formula as a lambda.
+//         With tol > 0 points passing F::interior() and, for F::periodic,
+//         orbits that return within tol of a Brent checkpoint stop at
+//         iter_max right away, same schedule as kernels::mandelbrotRow
+template <typename F, typename T>
+inline int escape(
+    const F& f,
+    const T& px,
+    const T& py,
+    const int iter_max,
+    const double th = 2.0,
+    const double tol = 0.0
+)
+{
+    using std::abs;
+    T zr, zi, cr, ci;
+    f.init(px, py, zr, zi, cr, ci);
+    if(tol > 0.0 && f.interior(cr, ci))
+        return iter_max;
+    const bool periodic = F::periodic && tol > 0.0;
+    const T th2 = T(th*th), tolt = T(tol);
+    T sr = zr, si = zi;
+    int check = 1;
+    int iter = 0;
+    while(zr*zr + zi*zi < th2 && iter < iter_max)
+    {
+        f.step(zr, zi, cr, ci);
+        ++iter;
+        if(periodic && (iter & 3) == 0
+            && abs(zr - sr) < tolt && abs(zi - si) < tolt)
+            return iter_max;
+        if(periodic && iter == check)
+        {
+            sr = zr;
+            si = zi;
+            check <<= 1;
+        }
+    }
+    return iter;
+}
+} // namespace formula
+} // namespace FRACTAL
+
+#endif // FRACT_FORMULA_H
@@ -1,13 +1,34 @@
 //#include <opencv2/core.hpp>
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <vector>
 #include <fstream>
+#include <sstream>
 
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include "antialias.h"
+#include "distance.h"
 #include "fract.h"
+#include "framepool.h"
+#include "framesink.h"
+#include "imagewriter.h"
+#include "iterdump.h"
+#include "iterstate.h"
+#include "kernels.h"
+#include "palette.h"
+#include "perturb.h"
+#include "renderworker.h"
+#include "reproject.h"
+#include "scheduler.h"
+#include "subdivide.h"
+#include "tilecache.h"
 #include "tools.h"
+#include "trace.h"
 
 using namespace std;
 using namespace FRACTAL;
@@ -63,42 +84,657 @@ void Fract::getNumberIterations(
 ) 
 {
 	cout << "process " << iter_max << " iters" << endl;
-	int k = 0, progress = -1;
-	cv::Mat iterMat(src.width(), src.height(), CV_8SC1);
-	iterMat.forEach<uchar>
-	(
-		[&src, &fract, &colors, &func, &iter_max](uchar &pixel, const int * position) -> void
+	RenderOptions opts;
+	// subdivision fills a uniform border on the grounds that the set and
+	// its bands are connected, which an arbitrary func does not promise
+	opts.subdivide = false;
+	renderPixels(
+		src,
+		colors,
+		[&src, &fract, &func, &iter_max](const int* xs, const int* ys, int n, int* out) -> void
 		{
 			const double th = 2.0;
-			auto y = position[0];
-			auto x = position[1];
-			Complex c((double)x, (double)y);
-			c = CSHelper::scale(src, fract, c);
-			colors[y*src.width() + x] = escape(c, iter_max, func, th);
+			for(int k = 0; k < n; ++k)
+			{
+				Complex c((double)xs[k], (double)ys[k]);
+				c = CSHelper::scale(src, fract, c);
+				out[k] = escape(c, iter_max, func, th);
+			}
+		},
+		opts
+	);
+}
+
+void Fract::getNumberIterations(
+	CS<int> &src, 
+	CS<double> &fract, 
+	int iter_max, 
+	std::vector<int> &colors,
+	const formula::Mandelbrot &f,
+	const RenderOptions &opts
+) 
+{
+	auto isa = kernels::activeIsa();
+	cout << "process " << iter_max << " iters::" << kernels::isaName(isa) << endl;
+	const int width = src.width(), height = src.height();
+	std::vector<double> cx(width), cy(height);
+	for(int x = 0; x < width; ++x)
+		cx[x] = CSHelper::scale(src, fract, Complex((double)x, 0.0)).real();
+	for(int y = 0; y < height; ++y)
+		cy[y] = CSHelper::scale(src, fract, Complex(0.0, (double)y)).imag();
+	const double tol = kernels::periodicityTol(fract.width()/width);
+	auto state = opts.state;
+	const bool same_window = state && state->matches(src, fract);
+	if(same_window && iter_max <= state->iter)
+	{
+		state->counts(iter_max, colors);
+		return;
+	}
+	const auto symmetry = symmetryOf<formula::Mandelbrot>(src, fract, opts);
+	if(!same_window && opts.cache && opts.cache->render(
+		src,
+		fract,
+		iter_max,
+		f.id,
+		colors,
+		[&iter_max, &tol](const double* cr, const double* ci, int n, int* out) -> void
+		{
+			kernels::mandelbrotPoints(cr, ci, n, iter_max, out, tol);
+		},
+		opts,
+		symmetry.kind
+	))
+	{
+		// no orbits kept: a raise of iter_max restarts the unescaped pixels
+		if(state && opts.cancelled())
+			state->clear();
+		else if(state)
+		{
+			state->reset(src, fract);
+			state->finish(colors, iter_max);
 		}
+		return;
+	}
+	if(state && !same_window)
+		state->reset(src, fract);
+	// pixels the previous frame saw escaping all around need no interior
+	// checks, which cost an escaping orbit time for nothing
+	const Reprojection* hints =
+		opts.reprojection && opts.reprojection->side.size() == colors.size() ?
+		opts.reprojection.get() : nullptr;
+	renderPixels(
+		src,
+		colors,
+		[&cx, &cy, &iter_max, &tol, &state, hints, width](const int* xs, const int* ys, int n, int* out) -> void
+		{
+			// subdivision borders are scattered, gather them so they fill
+			// the simd lanes like a row would; the hinted exterior first
+			thread_local std::vector<int> order, px, py, pout;
+			thread_local std::vector<double> pr, pi;
+			order.resize(n);
+			int outside = 0;
+			for(int k = 0; k < n; ++k)
+				if(hints && hints->side[ys[k]*width + xs[k]] == Reprojection::EXTERIOR)
+					order[outside++] = k;
+			for(int k = 0, rest = outside; k < n; ++k)
+				if(!hints || hints->side[ys[k]*width + xs[k]] != Reprojection::EXTERIOR)
+					order[rest++] = k;
+			px.resize(n);
+			py.resize(n);
+			pr.resize(n);
+			pi.resize(n);
+			pout.resize(n);
+			for(int k = 0; k < n; ++k)
+			{
+				px[k] = xs[order[k]];
+				py[k] = ys[order[k]];
+				pr[k] = cx[px[k]];
+				pi[k] = cy[py[k]];
+			}
+			// with a state of the same window only the unsettled orbits
+			// are iterated, from where they stopped
+			auto iterate = [&](const int from, const int to, const double t) -> void
+			{
+				if(from == to)
+					return;
+				if(state)
+					state->evaluate(
+						px.data() + from, py.data() + from, to - from,
+						pr.data() + from, pi.data() + from, iter_max, t, pout.data() + from
+					);
+				else
+					kernels::mandelbrotPoints(pr.data() + from, pi.data() + from, to - from, iter_max, pout.data() + from, t);
+			};
+			iterate(0, outside, 0.0);
+			iterate(outside, n, tol);
+			for(int k = 0; k < n; ++k)
+				out[order[k]] = pout[k];
+		},
+		opts,
+		symmetry
+	);
+	if(state && opts.cancelled())
+		state->clear();
+	else if(state)
+		state->finish(colors, iter_max);
+}
+
+void Fract::renderPixels(
+	const CS<int> &src,
+	std::vector<int> &colors,
+	const PixelEval &eval,
+	const RenderOptions &opts,
+	const Symmetry &symmetry
+)
+{
+	renderPixels(src, src, colors, eval, opts, symmetry);
+}
+
+namespace
+{
+//! @brief cost model: the slowest of the center and the corners of each
+//         tile, all probes in one call so the simd lanes stay full
+std::vector<double> probeTiles(
+	const std::vector<cv::Rect>& tiles,
+	const Fract::PixelEval& eval
+)
+{
+	std::vector<int> xs, ys;
+	for(const auto& t : tiles)
+	{
+		const int xr = t.x + t.width - 1, yb = t.y + t.height - 1;
+		xs.insert(xs.end(), {t.x + t.width/2, t.x, xr, t.x, xr});
+		ys.insert(ys.end(), {t.y + t.height/2, t.y, t.y, yb, yb});
+	}
+	std::vector<int> probe(xs.size());
+	eval(xs.data(), ys.data(), static_cast<int>(xs.size()), probe.data());
+	std::vector<double> cost(tiles.size());
+	for(size_t t = 0; t < tiles.size(); ++t)
+		cost[t] = 1.0 + *std::max_element(&probe[5*t], &probe[5*t] + 5);
+	return cost;
+}
+
+} // namespace
+
+void Fract::renderPixels(
+	const CS<int> &src,
+	const CS<int> &region,
+	std::vector<int> &colors,
+	const PixelEval &eval,
+	const RenderOptions &opts,
+	const Symmetry &symmetry
+)
+{
+	const cv::Rect rc = region.rc() & cv::Rect(0, 0, src.width(), src.height());
+	if(rc.empty())
+		return;
+	// the mirrored pixels are left out of every pass and copied after it
+	const cv::Rect mirrored = symmetry.mirrored(rc);
+	const int width = src.width();
+	auto mirror = [&]() -> void
+	{
+		if(!mirrored.empty() && !opts.cancelled())
+			symmetry.copy(colors, width, mirrored);
+	};
+	const Reprojection* previous = opts.reprojection
+		&& opts.reprojection->counts.size() == colors.size()
+		? opts.reprojection.get()
+		: nullptr;
+	if(!opts.progressive && !previous)
+	{
+		auto tiles = Symmetry::subtract(Scheduler::tiles(rc, opts.tile), mirrored);
+		auto cost = probeTiles(tiles, eval);
+		renderTiles(src, rc, tiles, cost, colors, eval, opts);
+		mirror();
+		return;
+	}
+	// progressive tiles hold whole 4x4 blocks so that a block never spans
+	// two threads; the pieces left beside the mirrored pixels start
+	// blocks of their own
+	auto tiles = Symmetry::subtract(
+		Scheduler::tiles(
+			rc,
+			opts.progressive ? std::max(4, (opts.tile + 3)/4*4) : opts.tile
+		),
+		mirrored
+	);
+	// a pixel is iterated once: exact counts of the previous frame and
+	// the samples of earlier passes are taken from here, tiles touch
+	// only their own pixels
+	std::vector<uint8_t> sampled(colors.size(), 0);
+	std::vector<int> samples(colors.size());
+	if(previous)
+	{
+		sampled = previous->exact;
+		samples = previous->counts;
+	}
+	std::atomic<size_t> iterated(0);
+	auto reuse = [&](const int* xs, const int* ys, int n, int* out) -> void
+	{
+		thread_local std::vector<int> slot, fxs, fys, fout;
+		slot.clear();
+		fxs.clear();
+		fys.clear();
+		for(int k = 0; k < n; ++k)
+		{
+			const int p = ys[k]*width + xs[k];
+			if(sampled[p])
+			{
+				out[k] = samples[p];
+				continue;
+			}
+			slot.push_back(k);
+			fxs.push_back(xs[k]);
+			fys.push_back(ys[k]);
+		}
+		if(slot.empty())
+			return;
+		fout.resize(slot.size());
+		eval(fxs.data(), fys.data(), static_cast<int>(slot.size()), fout.data());
+		for(size_t k = 0; k < slot.size(); ++k)
+		{
+			const int p = fys[k]*width + fxs[k];
+			out[slot[k]] = samples[p] = fout[k];
+			sampled[p] = 1;
+		}
+		iterated += slot.size();
+	};
+	auto cost = previous ? previous->cost(src, tiles) : probeTiles(tiles, reuse);
+	if(opts.progressive)
+	{
+		for(const int stride : {4, 2})
+		{
+			renderTiles(src, rc, tiles, cost, colors, reuse, opts, stride);
+			if(opts.cancelled())
+				return;
+			mirror();
+			if(opts.preview)
+				opts.preview(colors, stride);
+		}
+	}
+	renderTiles(src, rc, tiles, cost, colors, reuse, opts);
+	mirror();
+	cout << cv::format(
+		"renderPixels::iterated %.1f%%",
+		100.0*iterated/rc.area()
+	) << endl;
+}
+
+void Fract::renderTiles(
+	const CS<int> &src,
+	const cv::Rect &rc,
+	const std::vector<cv::Rect> &tiles,
+	std::vector<double> &cost,
+	std::vector<int> &colors,
+	const PixelEval &eval,
+	const RenderOptions &opts,
+	const int stride
+)
+{
+	const int width = src.width();
+	std::vector<double> slowest(stride > 1 ? tiles.size() : 0);
+	std::atomic<size_t> evaluated(0);
+	Trace::Span pass("pass");
+	auto stats = Scheduler::run(
+		tiles,
+		cost,
+		[&](const cv::Rect& tile, const size_t t) -> void
+		{
+			Trace::Span span("tile");
+			const size_t n = opts.subdivide
+				? Subdivision::render(src, colors, eval, tile, opts.subdivide_min, stride)
+				: Subdivision::brute(src, colors, eval, tile, stride);
+			evaluated += n;
+			if(span.active())
+			{
+				// iterations the counts stand for, filled rectangles too
+				double iters = 0.0;
+				for(int y = tile.y; y < tile.y + tile.height; y += stride)
+					for(int x = tile.x; x < tile.x + tile.width; x += stride)
+						iters += colors[y*width + x];
+				span.arg("pixels", static_cast<double>(n)).arg("iters", iters);
+			}
+			if(stride == 1)
+				return;
+			// coarse image: every block gets its sample, the slowest
+			// sample orders the tile in the next pass
+			int top = 0;
+			for(int y = tile.y; y < tile.y + tile.height; y += stride)
+			{
+				const int y1 = std::min(y + stride, tile.y + tile.height);
+				for(int x = tile.x; x < tile.x + tile.width; x += stride)
+				{
+					const int v = colors[y*width + x];
+					const int x1 = std::min(x + stride, tile.x + tile.width);
+					top = std::max(top, v);
+					for(int yy = y; yy < y1; ++yy)
+						std::fill(&colors[yy*width + x], &colors[yy*width + x1], v);
+				}
+			}
+			slowest[t] = 1.0 + top;
+		},
+		opts.threads,
+		opts.cancel.get()
 	);
+	pass.arg("stride", stride).arg("imbalance", stats.imbalance);
+	if(stride > 1)
+		cost.swap(slowest);
+	cout << (stride > 1 ? cv::format("pass 1/%d::", stride*stride) : string())
+		 << stats.info()
+		 << cv::format(" evaluated %.1f%%", 100.0*evaluated*stride*stride/rc.area())
+		 << endl;
+}
+
+void Fract::getNumberIterations(
+	CS<int> &src, 
+	const DeepCS &fract, 
+	int iter_max, 
+	std::vector<int> &colors,
+	const RenderOptions &opts
+) 
+{
+	cout << "process " << iter_max << " iters::perturbation" << endl;
+	Perturbation::render(src, fract, iter_max, colors, opts);
 }
 
 cv::Mat Fract::computeFractal(
   CS<int> &src, 
-  CS<double> &fract, 
+  const DeepCS &fract, 
   int iter_max, 
   std::vector<int> &colors,
-  const std::function<Complex( Complex, Complex)> &func, 
   const char *fname, 
   bool smooth_color,
   const bool show,
-  const bool write
+  const bool write,
+  const RenderOptions &opts
 ) 
 {
 	cout << "computeFractal..." << endl;
 	auto start = std::chrono::steady_clock::now();
-	getNumberIterations(src, fract, iter_max, colors, func);
+	{
+		Trace::Span span("compute");
+		getNumberIterations(src, fract, iter_max, colors, opts);
+	}
+	printGenerateTime(fname, start);
+	return Fract::plot(src, colors, iter_max, fname, smooth_color, show, write, opts.pool.get());
+}
+
+namespace
+{
+//! @brief a history frame fitted to the aspect of src: the offset of the
+//         corner from the recorded x1, y1, and the extent
+struct FrameFit
+{
+	double dx, dy, width, height;
+};
+
+FrameFit fitFrame(const CS<int> &src, const ZoomFrameHist &frame)
+{
+	const double width = frame.hp_w > 0.0 ? frame.hp_w : frame.x2 - frame.x1;
+	// deep frames before hph were all rendered square
+	const double height = frame.hp_h > 0.0 ? frame.hp_h
+		: frame.hp_w > 0.0 ? frame.hp_w : frame.y2 - frame.y1;
+	if(!(width > 0.0) || !(height > 0.0))
+		throw std::runtime_error(cv::format("Fract::empty window at frame %d", frame.frame_number));
+	// the whole recorded window in sight, about the same centre
+	const double aspect = double(src.height())/src.width();
+	FrameFit fit{0.0, 0.0, width, height};
+	if(height > width*aspect)
+		fit.width = height/aspect;
+	else
+		fit.height = width*aspect;
+	fit.dx = (width - fit.width)/2;
+	fit.dy = (height - fit.height)/2;
+	return fit;
+}
+} // namespace
+
+Precision Fract::countFrame(
+  CS<int> &src, 
+  const ZoomFrameHist &frame, 
+  int iter_max, 
+  std::vector<int> &colors,
+  const RenderOptions &opts
+) 
+{
+	CS<double> fract = frameWindow(src, frame);
+	const int limbs = BigFixed::limbsFor(fract.width()/src.width());
+	DeepCS deep(fract, limbs);
+	if(!frame.hp_x1.empty())
+	{
+		// the offset from the recorded corner is small, exact in double
+		const auto fit = fitFrame(src, frame);
+		deep.x_min = BigFixed::fromString(frame.hp_x1, limbs) + BigFixed::fromDouble(fit.dx, limbs);
+		deep.y_min = BigFixed::fromString(frame.hp_y1, limbs) + BigFixed::fromDouble(fit.dy, limbs);
+		fract = deep.toCS();
+	}
+	const auto precision = opts.precisionFor(deep.spacing(src));
+	Trace::Span span("compute");
+	if(precision == Precision::PERTURBATION)
+		getNumberIterations(src, deep, iter_max, colors, opts);
+	else if(precision == Precision::DOUBLE_DOUBLE)
+	{
+		auto fract_dd = deep.toDDCS();
+		getNumberIterations(src, fract_dd, iter_max, colors, formula::Mandelbrot(), opts);
+	}
+	else
+		getNumberIterations(src, fract, iter_max, colors, formula::Mandelbrot(), opts);
+	return precision;
+}
+
+cv::Mat Fract::computeFrame(
+  CS<int> &src, 
+  const ZoomFrameHist &frame, 
+  int iter_max, 
+  std::vector<int> &colors,
+  bool smooth_color,
+  const RenderOptions &opts
+) 
+{
+	cout << "computeFrame..." << endl;
+	auto fname = cv::format("frame %d", frame.frame_number);
+	if(opts.distance_estimate)
+	{
+		CS<double> fract = frameWindow(src, frame);
+		if(opts.precisionFor(fract.width()/src.width()) == Precision::DOUBLE)
+			return distanceFractal(src, fract, iter_max, colors, fname.c_str(), false, opts);
+	}
+	auto start = std::chrono::steady_clock::now();
+	const auto precision = countFrame(src, frame, iter_max, colors, opts);
+	printGenerateTime(fname.c_str(), start);
+	auto bitmap = Fract::plot(src, colors, iter_max, fname.c_str(), smooth_color, false, false, opts.pool.get());
+	if(precision == Precision::DOUBLE)
+		antiAlias(src, frameWindow(src, frame), colors, iter_max, smooth_color, bitmap, opts);
+	return bitmap;
+}
+
+int Fract::autoIterMax(
+  const CS<int> &src, 
+  const DeepCS &fract, 
+  const double depth,
+  const RenderOptions &opts
+) 
+{
+	const int lo = std::max(1, opts.auto_iter_min);
+	const int hi = std::max(lo, opts.auto_iter_max);
+	// every probe point evaluated on its own and nothing kept: the grid
+	// is too sparse for subdivision, the frame state is not the probe's
+	RenderOptions probe_opts = opts;
+	probe_opts.subdivide = false;
+	probe_opts.progressive = false;
+	probe_opts.preview = nullptr;
+	probe_opts.reprojection.reset();
+	probe_opts.state.reset();
+	probe_opts.cache.reset();
+	probe_opts.pool.reset();
+	// the precision of the frame, the probe points lie on its window
+	const auto precision = opts.precisionFor(fract.spacing(src));
+	const int gw = std::max(1, std::min(opts.auto_iter_probe, src.width()));
+	const int gh = std::max(1, static_cast<int>(std::lround(double(gw)*src.height()/src.width())));
+	CS<int> grid(0, gw, 0, gh);
+	std::vector<int> counts(grid.size());
+	// deeper windows have longer escapes; the cap only bounds the probe,
+	// it grows while the escapes reach into its upper half
+	int cap = static_cast<int>(std::min<double>(hi, 4.0*lo*(1.0 + std::max(depth, 0.0)/8.0)));
+	const size_t allowed = static_cast<size_t>(opts.auto_iter_tail*counts.size());
+	std::vector<int> escaped;
+	for(;;)
+	{
+		std::fill(counts.begin(), counts.end(), 0);
+		if(precision == Precision::PERTURBATION)
+			getNumberIterations(grid, fract, cap, counts, probe_opts);
+		else if(precision == Precision::DOUBLE_DOUBLE)
+		{
+			auto fract_dd = fract.toDDCS();
+			getNumberIterations(grid, fract_dd, cap, counts, formula::Mandelbrot(), probe_opts);
+		}
+		else
+		{
+			auto fract_d = fract.toCS();
+			getNumberIterations(grid, fract_d, cap, counts, formula::Mandelbrot(), probe_opts);
+		}
+		escaped.clear();
+		for(const int c : counts)
+			if(c < cap)
+				escaped.push_back(c);
+		const size_t late = std::count_if(
+			escaped.begin(),
+			escaped.end(),
+			[cap](const int c) { return c >= cap/2; }
+		);
+		if(late <= allowed || cap >= hi || opts.cancelled())
+			break;
+		cap = static_cast<int>(std::min<int64_t>(hi, int64_t(cap)*4));
+	}
+	// the smallest n leaving at most allowed points black that escape
+	// by the cap, with a margin for the pixels between probe points
+	std::sort(escaped.begin(), escaped.end(), std::greater<int>());
+	const int n = allowed < escaped.size() ? escaped[allowed] + 1 : lo;
+	const int chosen = std::max(lo, std::min(hi, static_cast<int>(std::ceil(1.25*n))));
+	cout << cv::format(
+		"Fract::auto iter_max %d, depth 2^%.1f, probe %dx%d cap %d, %.1f%% interior",
+		chosen,
+		depth,
+		gw,
+		gh,
+		cap,
+		100.0*(counts.size() - escaped.size())/counts.size()
+	) << endl;
+	return chosen;
+}
+
+CS<double> Fract::frameWindow(
+  const CS<int> &src, 
+  const ZoomFrameHist &frame
+) 
+{
+	const auto fit = fitFrame(src, frame);
+	const double x = frame.x1 + fit.dx, y = frame.y1 + fit.dy;
+	return CS<double>(x, x + fit.width, y, y + fit.height);
+}
+
+void Fract::antiAlias(
+  const CS<int> &src, 
+  const CS<double> &fract, 
+  const std::vector<int> &colors,
+  int iter_max,
+  bool smooth_color,
+  cv::Mat &bitmap,
+  const RenderOptions &opts
+) 
+{
+	if(opts.aa_samples < 1 || opts.cancelled())
+		return;
+	const double tol = kernels::periodicityTol(fract.width()/src.width());
+	auto stats = AntiAlias::render(
+		src,
+		fract,
+		colors,
+		iter_max,
+		Palette::forSmooth(smooth_color),
+		[&iter_max, &tol](const double* cr, const double* ci, int n, int* out) -> void
+		{
+			kernels::mandelbrotPoints(cr, ci, n, iter_max, out, tol);
+		},
+		bitmap,
+		opts
+	);
+	cout << stats.info() << endl;
+}
+
+cv::Mat Fract::distanceFractal(
+  CS<int> &src, 
+  CS<double> &fract, 
+  int iter_max, 
+  std::vector<int> &colors,
+  const char *fname, 
+  const bool write,
+  const RenderOptions &opts
+) 
+{
+	cout << "distanceFractal..." << endl;
+	auto start = std::chrono::steady_clock::now();
+	std::vector<float> distance;
+	auto stats = DistanceEstimate::render(src, fract, iter_max, colors, distance, opts);
+	cout << stats.info() << endl;
+	printGenerateTime(fname, start);
+	cv::Mat bitmap;
+	{
+		Trace::Span span("colorize");
+		if(opts.pool)
+			bitmap = opts.pool->image(src.height(), src.width(), CV_8UC3);
+		DistanceEstimate::colorize(
+			colors,
+			distance,
+			src.width(),
+			src.height(),
+			iter_max,
+			opts.de_thickness,
+			bitmap
+		);
+	}
+	if(opts.aa_samples > 0 && !opts.cancelled())
+		cout << DistanceEstimate::antiAlias(src, fract, colors, distance, iter_max, bitmap, opts).info() << endl;
+	if(write)
+	{
+		Trace::Span span("encode");
+		cv::imwrite(fname, bitmap);
+		cout << "written at " << fname << endl;
+	}
+	return bitmap;
+}
+
+void Fract::printGenerateTime(
+	const char *fname,
+	const std::chrono::steady_clock::time_point& start
+)
+{
 	auto end = std::chrono::steady_clock::now();
 	std::cout << "time to generate "
 			  << fname << " = " 
 			  << std::chrono::duration <double, std::milli> (end - start).count() 
 			  << " [ms]" << std::endl;
+}
+
+cv::Mat Fract::computeFractal(
+  CS<int> &src, 
+  CS<double> &fract, 
+  int iter_max, 
+  std::vector<int> &colors,
+  const std::function<Complex( Complex, Complex)> &func, 
+  const char *fname, 
+  bool smooth_color,
+  const bool show,
+  const bool write
+) 
+{
+	cout << "computeFractal..." << endl;
+	auto start = std::chrono::steady_clock::now();
+	{
+		Trace::Span span("compute");
+		getNumberIterations(src, fract, iter_max, colors, func);
+	}
+	printGenerateTime(fname, start);
 	return Fract::plot(src, colors, iter_max, fname, smooth_color, show, write);
 }
 
@@ -114,203 +750,509 @@ CS<double> Fract::mandelbrot(
 {
 	CS<int> src(0, outimg_w, 0, outimg_h);
 	CS<double> fract(x1y1.x, x2y2.x, x1y1.y, x2y2.y);
+	DeepCS deep(fract, BigFixed::limbsFor(fract.width()/outimg_w));
 	//! @attention the function used to calculate the fractal
 	// auto func = [] (Complex z, Complex c) -> Complex {return Complex(cos(45),cos(30))* z * z  + c; };
-	auto func = [] (Complex z, Complex c) -> Complex {return z * z  + c; };
+	// or any formula from formula.h, z * z + c runs on the simd kernel
+	formula::Mandelbrot func;
 	string fname_pr = "mandelbrot.%03d.png";
 	string histname_pr = "mandelbrot.fhistory";
-	cv::Mat lastOut;
+	const bool smooth_color = true;
+	// render thread only: the frame before, reprojected into the next one
+	FramePool::Counts prev_colors;
+	CS<double> prev_fract(fract);
+	DeepCS prev_deep(deep);
+	int prev_iter = max_iter;
+	// raised by the viewer keys; with keep_state z of every pixel is kept
+	// so that a raise on the same window continues the unescaped pixels only
+	int iter_max = max_iter;
+	auto iter_state = options.state;
+	if(!iter_state && options.keep_state)
+		iter_state = std::make_shared<IterState>();
+	// count and image buffers of finished frames serve the next ones
+	auto pool = options.pool ? options.pool : std::make_shared<FramePool>();
+	auto cache = options.cache;
+	if(!cache && options.cache_tiles > 0)
+		cache = std::make_shared<TileCache>(
+			options.tile,
+			options.cache_tiles,
+			options.cache_disk ? join(this->outDir, "tiles") : ""
+		);
 	auto hist_path = join(this->outDir, histname_pr);
-	for(int i = 0; i < 1000; ++i)
-	{
-		string fname = cv::format(fname_pr.c_str(), i);
-		auto f_path = join(this->outDir, fname);
-		bool smooth_color = true;
-		std::vector<int> colors(src.size());
-		cv::Rect targetBbox;
-		bool zoomDone(false);
-		cout << "zoom until press Esc..." << endl;
-		double curx1(fract.x_min()),
-			   curx2(fract.x_max()),
-			   cury1(fract.y_min()),
-			   cury2(fract.y_max());
-		double newx1(fract.x_min()),
-			   newx2(fract.x_max()),
-			   newy1(fract.y_min()),
-			   newy2(fract.y_max());
-		auto viewer = Viewer(lastOut, max_iter);
-		if(show && ! lastOut.empty())
+	if(!options.trace.empty())
+		Trace::enable();
+
+	//! @brief a frame to render: the window and how it was reached
+	struct Target
+	{
+		int number;
+		CS<double> fract;
+		DeepCS deep;
+		int iter_max;
+		//! @brief only iter_max changed since the frame it came from
+		bool same_window;
+		//! @brief iter_max is picked by the render job (auto_iter)
+		bool auto_iter;
+	};
+	int frames = 0;
+	// the window of pixels [pixx1, pixx2] x [pixy1, pixy2] of the frame
+	// from, at iter_max; same_window keeps the window of from
+	auto zoomTo = [&](
+		const Target& from,
+		const double pixx1,
+		const double pixx2,
+		const double pixy1,
+		const double pixy2,
+		const bool same_window
+	) -> Target
+	{
+		Target to{frames++, from.fract, from.deep, iter_max, same_window, false};
+		if(same_window)
 		{
-			int pressedKey = 0;
-			while(!zoomDone)
-			{
-				string window_name = "FRACT";
-				auto viewer2draw = viewer.drawWithCursor();
-				cv::Mat view2show;
-				cv::resize(viewer2draw, view2show, {1000,1000});
-				string max_iter_info = cv::format(
-					"MAX_IT::%d", 
-					max_iter
-				);
-				string solve_space_size = cv::format(
-					"SOLVE_SPACE_SIZE::{%d : %d}", 
-					outimg_w, 
-					outimg_h
-				);
-				string pressed_info = cv::format(
-					"LAST_PRESSED_KEY::%d", pressedKey 
-				);
-				string fract_pose_info = cv::format(
-					"POSE_IN_FRACT:: {%.6f, %.6f, %.6f, %.6f}", 
-					curx1, 
-					cury1, 
-					curx2, 
-					cury2 
-				);
-				std::vector<string> infs {
-						pressed_info,
-						max_iter_info,
-						fract_pose_info,
-						solve_space_size
-				};
-				cv::Mat img2black = view2show({
-					0,
-					0,
-					int(view2show.cols*2/3),
-					int(20*(infs.size()+1))
-				});
-				img2black.setTo(cv::Scalar(0,0,0));
-				FRACTAL::putTexts(
-					view2show,
-					infs,
-					{
-						10,
-						20
-					},
-					20,
-					0,
-					{255,0,255},
-					1.0
-				);
-				cv::imshow(window_name, view2show);
-				pressedKey = cv::waitKey(0);
-				std::vector<Viewer::KeyboardKeys> commands;
-				if(!Viewer::waitKey2Control(pressedKey, commands))
-					zoomDone = true;
-				// cout << "pressed::" << pressedKey << endl;
-				viewer.moveByKey({static_cast<FRACTAL::Viewer::KeyboardKeys>(pressedKey)});
-				viewer.moveTox1x2y1y2<double>(
-					newx1,
-					newx2,
-					newy1,
-					newy2
-				);
-				auto new_pt1 = CSHelper::scale<int, double>(src, fract, {newx1, newy1});
-				auto new_pt2 = CSHelper::scale<int, double>(src, fract, {newx2, newy2});
-				newx1 = new_pt1.first;
-				newx2 = new_pt2.first;
-				newy1 = new_pt1.second;
-				newy2 = new_pt2.second;
-				cout << "x1: " << newx1 << endl
-					 << "y1: " << newy1 << endl
-					 << "x2: " << newx2 << endl
-					 << "y2: " << newy2 << endl;
-				// bool showCrosshair = true;
-				// bool fromCenter = false;
-				// string sel_window = "FRACT::SelectRoi()";
-				// cout << sel_window << endl;
-				// targetBbox = cv::selectROI(sel_window, lastOut, showCrosshair, fromCenter);
-				// if(targetBbox.width > targetBbox.height)
-				// 	targetBbox.height = targetBbox.width;
-				// else
-				// 	targetBbox.width = targetBbox.height;
-				// cv::destroyWindow(sel_window);
-			}
+			// the window's line in the history gets the newest iter_max
+			if(!to.fract.zoom_history.empty())
+				to.fract.zoom_history.back().iter_max = to.iter_max;
+			return to;
 		}
-
-		if(targetBbox.area()>0)
+		auto new_pt1 = CSHelper::scale<int, double>(src, to.fract, {pixx1, pixy1});
+		auto new_pt2 = CSHelper::scale<int, double>(src, to.fract, {pixx2, pixy2});
+		double newx1 = new_pt1.first,
+			   newx2 = new_pt2.first,
+			   newy1 = new_pt1.second,
+			   newy2 = new_pt2.second;
+		cout << "x1: " << newx1 << endl
+			 << "y1: " << newy1 << endl
+			 << "x2: " << newx2 << endl
+			 << "y2: " << newy2 << endl;
+		// on the grid of the tile cache, while double precision lasts
+		const bool snap = cache
+			&& options.precisionFor((newx2 - newx1)/outimg_w) == Precision::DOUBLE;
+		if(snap)
 		{
-			auto new_pt1 = CSHelper::scale<int, double>(src, fract, {targetBbox.x, targetBbox.y});
-			auto new_pt2 = CSHelper::scale<int, double>(src, fract, {
-				targetBbox.x + targetBbox.width, 
-				targetBbox.y + targetBbox.height
-			});
-			newx1 = new_pt1.first;
-			newx2 = new_pt2.first;
-			newy1 = new_pt1.second;
-			newy2 = new_pt2.second;
+			auto grid = TileCache::snap(src, newx1, newx2, newy1, newy2);
+			to.fract.zoom(
+				double(outimg_h)/outimg_w, 
+				grid.x_min(), 
+				grid.x_max(), 
+				grid.y_min(), 
+				grid.y_max()
+			);
 		}
+		else
+			to.fract.zoom(
+				1.0, 
+				newx1, 
+				newx2, 
+				newy1, 
+				newy2
+			);
+		if(options.deep_zoom)
+		{
+			if(snap)
+				to.deep = DeepCS(to.fract, BigFixed::limbsFor(to.fract.width()/outimg_w));
+			else
+				to.deep.zoom(src, 1.0, pixx1, pixx2, pixy1);
+			auto deep_fract = to.deep.toCS();
+			to.fract.reset(
+				deep_fract.x_min(),
+				deep_fract.x_max(),
+				deep_fract.y_min(),
+				deep_fract.y_max()
+			);
+			to.fract.zoom_history.back().hp_x1 = to.deep.x_min.toString();
+			to.fract.zoom_history.back().hp_y1 = to.deep.y_min.toString();
+			to.fract.zoom_history.back().hp_w = to.deep.width;
+			to.fract.zoom_history.back().hp_h = to.deep.height;
+		}
+		to.auto_iter = options.auto_iter;
+		to.fract.zoom_history.back().iter_max = to.iter_max;
+		return to;
+	};
+	// iter_max picked by the auto_iter jobs, by job number; taken into
+	// their targets by the ui thread
+	std::mutex picked_lock;
+	std::map<size_t, int> picked;
 
-		fract.zoom(
-			1.0, 
-			newx1, 
-			newx2, 
-			newy1, 
-			newy2
+	// declared before the worker: frames queued by its last job are
+	// written before mandelbrot() returns
+	ImageWriter writer(options.writers, options.write_queue);
+	std::unique_ptr<FrameSink> video;
+	if(write && !options.video.empty())
+		video = FrameSink::open(
+			options.video[0] == '|' ? options.video : join(this->outDir, options.video),
+			options.video_fps,
+			cv::Size(outimg_w, outimg_h)
 		);
+	RenderWorker worker;
+	// runs on the worker thread; coarse passes and the frame are
+	// published for the ui, a cancelled frame is neither kept nor written
+	auto render = [&](
+		Target target,
+		const std::shared_ptr<const CancelToken>& cancel,
+		const size_t job
+	) -> void
+	{
+		auto& fract = target.fract;
+		auto& deep = target.deep;
+		if(target.auto_iter)
+		{
+			// the probe is part of the job: a newer one cancels it too
+			RenderOptions probe_options = options;
+			probe_options.cancel = cancel;
+			const auto& first = fract.zoom_history.front();
+			const double width0 = first.hp_w > 0.0 ? first.hp_w : first.x2 - first.x1;
+			const double width = options.deep_zoom ? deep.width : fract.width();
+			target.iter_max = autoIterMax(
+				src,
+				options.deep_zoom ? deep : DeepCS(fract, BigFixed::limbsFor(width/src.width())),
+				std::log2(width0/width),
+				probe_options
+			);
+			if(cancel->cancelled())
+				return;
+			fract.zoom_history.back().iter_max = target.iter_max;
+			std::lock_guard<std::mutex> guard(picked_lock);
+			picked[job] = target.iter_max;
+		}
+		const int iter_max = target.iter_max;
+		Trace::Span span("frame");
+		span.arg("frame", target.number).arg("iter_max", iter_max);
+		auto f_path = join(this->outDir, cv::format(fname_pr.c_str(), target.number));
+		auto counts = pool->counts(src.size());
+		auto& colors = *counts;
+		const auto precision = options.precisionFor(deep.spacing(src));
+		RenderOptions frame_options = options;
+		frame_options.cancel = cancel;
+		frame_options.pool = pool;
+		if(show)
+		{
+			// coarse passes go on screen while the full frame is computed
+			frame_options.progressive = true;
+			frame_options.preview = [&src, &worker, &pool, job, iter_max, smooth_color](
+				const std::vector<int>& coarse,
+				const int stride
+			) -> void
+			{
+				Trace::Span span("preview");
+				cv::Mat bitmap = pool->image(src.height(), src.width(), CV_8UC3);
+				Palette::forSmooth(smooth_color).colorize(coarse, src.width(), src.height(), iter_max, bitmap);
+				worker.publish(job, bitmap, false);
+				cout << "preview 1/" << stride*stride << endl;
+			};
+		}
+		frame_options.state = iter_state;
+		frame_options.cache = cache;
+		// distance frames iterate from the block corners, no counts to reuse
+		if(options.reproject && prev_colors && !target.same_window && !options.distance_estimate)
+		{
+			frame_options.reprojection = std::make_shared<const Reprojection>(
+				options.deep_zoom
+					? Reprojection::map(src, *prev_colors, prev_iter, prev_deep, deep, iter_max)
+					: Reprojection::map(src, *prev_colors, prev_iter, prev_fract, fract, iter_max)
+			);
+		}
 		cout << "HISTORY" << endl;
-		std::vector<std::string> str_history;
-		ofstream f(hist_path);
-		for(const auto& fz: fract.zoom_history)
 		{
-			cout << fz.info() << endl;
-			f << fz.info2file() << '\n';
+			Trace::Span span("history");
+			std::vector<std::string> str_history;
+			ofstream f(hist_path);
+			for(const auto& fz: fract.zoom_history)
+			{
+				cout << fz.info() << endl;
+				f << fz.info2file() << '\n';
+			}
+			cout << "written to " << hist_path << endl;
+			f.close();
 		}
-		cout << "written to " << hist_path << endl;
 		auto midFract = fract.middle();
-		f.close();
 		cout << fract.info() << endl;
 			cout << "ti che" << endl;
-		lastOut = computeFractal(
-			src, 
-			fract, 
-			max_iter, 
-			colors, 
-			func, 
-			f_path.c_str(), 
-			smooth_color, 
-			show, 
-			write
-		);
-		if(!lastOut.empty())
+		cv::Mat out;
+		if(precision == Precision::PERTURBATION)
+			out = computeFractal(
+				src, 
+				deep, 
+				iter_max, 
+				colors, 
+				f_path.c_str(), 
+				smooth_color, 
+				false, 
+				false,
+				frame_options
+			);
+		else if(precision == Precision::DOUBLE_DOUBLE)
+		{
+			auto fract_dd = deep.toDDCS();
+			out = computeFractal(
+				src, 
+				fract_dd, 
+				iter_max, 
+				colors, 
+				func, 
+				f_path.c_str(), 
+				smooth_color, 
+				false, 
+				false,
+				frame_options
+			);
+		}
+		else if(options.distance_estimate)
+			out = distanceFractal(
+				src, 
+				fract, 
+				iter_max, 
+				colors, 
+				f_path.c_str(), 
+				false,
+				frame_options
+			);
+		else
+			out = computeFractal(
+				src, 
+				fract, 
+				iter_max, 
+				colors, 
+				func, 
+				f_path.c_str(), 
+				smooth_color, 
+				false, 
+				false,
+				frame_options
+			);
+		if(precision == Precision::DOUBLE && !options.distance_estimate)
+			antiAlias(src, fract, colors, iter_max, smooth_color, out, frame_options);
+		if(cancel->cancelled())
+			return;
+		// a distance frame fills whole blocks with the count of one corner,
+		// counts no re-coloring could trust
+		if(write && options.dump_iters && options.distance_estimate && precision == Precision::DOUBLE)
+			cout << "Fract::mandelbrot::no iteration dump of a distance estimate frame" << endl;
+		else if(write && options.dump_iters)
+		{
+			Trace::Span span("dump");
+			const bool smooth = options.dump_smooth && precision == Precision::DOUBLE;
+			IterDump::save(
+				join(this->outDir, cv::format("mandelbrot.%03d.fiter", target.number)),
+				src,
+				fract,
+				iter_max,
+				func.id,
+				colors,
+				smooth ? IterDump::smoothCounts(src, fract, iter_max, colors) : std::vector<float>(),
+				options.dump_compact
+			);
+		}
+		if(video)
+			video->write(out);
+		else if(write)
+			writer.write(f_path, out);
+		if(!out.empty())
 			cout << "done" << endl;
+		worker.publish(job, out, true);
+		prev_colors = counts;
+		prev_fract = fract;
+		prev_deep = deep;
+		prev_iter = iter_max;
+	};
+	// the window of every job not superseded yet, for zooms from its frames
+	std::map<size_t, Target> targets;
+	auto submit = [&](const Target& target) -> size_t
+	{
+		const size_t job = worker.submit(
+			// a copy: the worker may outlive render while unwinding
+			[render, target](const std::shared_ptr<const CancelToken>& cancel, const size_t job)
+			{
+				render(target, cancel, job);
+			}
+		);
+		targets.emplace(job, target);
+		return job;
+	};
+	// the iter_max job picked, if it did, into its target: the windows
+	// zoomed from its frame carry it in their history
+	auto adopt = [&](const size_t job) -> void
+	{
+		std::lock_guard<std::mutex> guard(picked_lock);
+		auto it = picked.find(job);
+		if(it == picked.end())
+			return;
+		auto& target = targets.at(job);
+		target.iter_max = iter_max = it->second;
+		target.fract.zoom_history.back().iter_max = it->second;
+		picked.erase(picked.begin(), ++it);
+	};
+
+	Target current = zoomTo(
+		Target{0, fract, deep, iter_max, false, false},
+		0, 
+		outimg_w, 
+		0, 
+		outimg_h, 
+		false
+	);
+	// every frame written before the trace, its encodes included
+	auto finish = [&]() -> void
+	{
+		worker.wait();
+		writer.flush();
+		cout << writer.stats().info() << endl;
+		cout << pool->stats().info() << endl;
+		if(options.trace.empty())
+			return;
+		Trace::write(join(this->outDir, options.trace));
+		cout << Trace::summary() << endl;
+	};
+	frames = 1;
+	size_t job = submit(current);
+	if(!show)
+	{
+		for(int i = 1; i < 1000; ++i)
+		{
+			worker.wait();
+			adopt(job);
+			current = zoomTo(targets.at(job), 0, outimg_w, 0, outimg_h, false);
+			job = submit(current);
+		}
+		finish();
+		adopt(job);
+		return targets.at(job).fract;
 	}
-	return fract;
-}
 
-cv::Mat vizOut(const cv::Mat& computed_fract)
-{
-	
+	// ui thread: always shows the newest frame, coarse or complete, and
+	// never waits for a render; a zoom or an iteration change supersedes
+	// the render in flight
+	cout << "zoom until press Esc..." << endl;
+	RenderWorker::Frame frame;
+	size_t seen = 0;
+	size_t shown = 0;
+	auto viewer = Viewer(cv::Mat(), iter_max);
+	int pressedKey = 0;
+	bool redraw = false;
+	// kept across redraws, a keypress does not reallocate them
+	cv::Mat viewer2draw, view2show;
+	while(frames < 1000)
+	{
+		if(worker.latest(frame, seen))
+		{
+			if(frame.job != shown)
+			{
+				// picked before the first pass was published
+				adopt(frame.job);
+				viewer = Viewer(frame.image, iter_max);
+				shown = frame.job;
+				targets.erase(targets.begin(), targets.find(shown));
+			}
+			else
+				viewer.src2view = frame.image;
+			redraw = true;
+		}
+		if(redraw && !viewer.src2view.empty())
+		{
+			const auto& window = targets.at(shown).fract;
+			string window_name = "FRACT";
+			Trace::Span span("draw");
+			viewer.drawWithCursor(viewer2draw);
+			cv::resize(viewer2draw, view2show, {1000,1000});
+			string max_iter_info = cv::format(
+				"MAX_IT::%d%s", 
+				viewer.maxIter,
+				worker.busy() ? " (rendering)" : ""
+			);
+			string solve_space_size = cv::format(
+				"SOLVE_SPACE_SIZE::{%d : %d}", 
+				outimg_w, 
+				outimg_h
+			);
+			string pressed_info = cv::format(
+				"LAST_PRESSED_KEY::%d", pressedKey 
+			);
+			string fract_pose_info = cv::format(
+				"POSE_IN_FRACT:: {%.6f, %.6f, %.6f, %.6f}", 
+				window.x_min(), 
+				window.y_min(), 
+				window.x_max(), 
+				window.y_max() 
+			);
+			std::vector<string> infs {
+					pressed_info,
+					max_iter_info,
+					fract_pose_info,
+					solve_space_size
+			};
+			cv::Mat img2black = view2show({
+				0,
+				0,
+				int(view2show.cols*2/3),
+				int(20*(infs.size()+1))
+			});
+			img2black.setTo(cv::Scalar(0,0,0));
+			FRACTAL::putTexts(
+				view2show,
+				infs,
+				{
+					10,
+					20
+				},
+				20,
+				0,
+				{255,0,255},
+				1.0
+			);
+			cv::imshow(window_name, view2show);
+			redraw = false;
+		}
+		// polls, so new frames show up while no key is pressed
+		const int key = cv::waitKey(30);
+		if(key == Viewer::KeyboardKeys::NO_KEY || viewer.src2view.empty())
+			continue;
+		pressedKey = key;
+		redraw = true;
+		std::vector<Viewer::KeyboardKeys> commands;
+		const bool zoom = !Viewer::waitKey2Control(pressedKey, commands);
+		const bool iters = pressedKey == Viewer::KeyboardKeys::ITERS_ADD
+			|| pressedKey == Viewer::KeyboardKeys::ITERS_REMOVE;
+		// cout << "pressed::" << pressedKey << endl;
+		viewer.moveByKey({static_cast<FRACTAL::Viewer::KeyboardKeys>(pressedKey)});
+		if(!zoom && !iters)
+			continue;
+		iter_max = viewer.maxIter;
+		double pixx1, pixx2, pixy1, pixy2;
+		viewer.moveTox1x2y1y2<double>(
+			pixx1,
+			pixx2,
+			pixy1,
+			pixy2
+		);
+		// only the iteration keys: render the same window again
+		// the iteration keys step from what auto_iter picked, shown with
+		// the first pass of the new window
+		current = zoomTo(targets.at(shown), pixx1, pixx2, pixy1, pixy2, !zoom);
+		job = submit(current);
+	}
+	finish();
+	adopt(job);
+	return targets.at(job).fract;
 }
 
-std::tuple<int, int, int> get_rgb_piecewise_linear(int n, int iter_max) {
-	int N = 256; // colors per element
-	int N3 = N * N * N;
-	// map n on the 0..1 interval (real numbers)
-	double t = (double)n/(double)iter_max;
-	// expand n on the 0 .. 256^3 interval (integers)
-	n = (int)(t * (double) N3);
-	int b = n/(N * N);
-	int nn = n - b * N * N;
-	int r = nn/N;
-	int g = nn - r * N;
-	return std::tuple<int, int, int>(r, g, b);
+cv::Mat Fract::plot(
+	const IterDump &dump, 
+	bool smooth_color,
+	const bool smooth_counts
+) 
+{
+	cv::Mat bitmap;
+	const auto& palette = Palette::forSmooth(smooth_color);
+	if(smooth_counts && dump.smooth())
+		palette.colorize(dump.smooth(), dump.width(), dump.height(), dump.iterMax(), bitmap);
+	else if(dump.counts16())
+		palette.colorize(dump.counts16(), dump.width(), dump.height(), dump.iterMax(), bitmap);
+	else
+		palette.colorize(dump.counts(), dump.width(), dump.height(), dump.iterMax(), bitmap);
+	return bitmap;
 }
 
-std::tuple<int, int, int> iters2rgbBernsteinPoly(
-	const int n, 
-	const int iter_max
-) 
+cv::Mat vizOut(const cv::Mat& computed_fract)
 {
-	// map n on the 0..1 interval
-	double t = (double)n/(double)iter_max;
-	int r = (int)(42*(1-t)*t*255);
-	int g = (int)(11*(1-t)*(1-t)*3*t*t*255);
-	int b =  (int)(22.5*(1-t)*(1-t)*(1-t)*t*255);	
-	// int r = (int)(42*(1-t)*t*255);
-	// int g = (int)(15*(1-t)*(1-t)*t*t*255);
-	// int b =  (int)(2.5*(1-t)*(1-t)*(1-t)*t*255);	
-	return std::tuple<int, int, int>(r, g, b);
 	
 }
 
@@ -338,41 +1280,26 @@ cv::Mat Fract::plot(
 	const char *fname, 
 	bool smooth_color,
 	const bool show,
-	const bool write
+	const bool write,
+	FramePool* pool
 ) 
 {
-	unsigned int width = src.width(), height = src.height();
-	cv::Mat bitmap(width, height, CV_8UC3);
-	int k = 0;
-	std::tuple<int, int, int> rgb;
-	for(int i = src.y_min(); i < src.y_max(); ++i) {
-		for(int j = src.x_min(); j < src.x_max(); ++j) {
-			int n = colors[k];
-			if( !smooth_color ) {
-				rgb = get_rgb_piecewise_linear(n, iter_max);
-			}
-			else {
-				rgb = iters2rgbBernsteinPoly(n, iter_max);
-			}
-			// or revert indxs?
-			cv::Scalar col_bgr {
-				static_cast<double>(std::get<2>(rgb)),
-				static_cast<double>(std::get<1>(rgb)),
-				static_cast<double>(std::get<0>(rgb)),
-			};
-
-			cv::circle(
-				bitmap,
-				{j,i},
-				1,
-				col_bgr,
-				1
-			);
-			k++;
-		}
+	cv::Mat bitmap;
+	{
+		Trace::Span span("colorize");
+		if(pool)
+			bitmap = pool->image(src.height(), src.width(), CV_8UC3);
+		Palette::forSmooth(smooth_color).colorize(
+			colors,
+			src.width(),
+			src.height(),
+			iter_max,
+			bitmap
+		);
 	}
 	if(write)
 	{
+		Trace::Span span("encode");
 		cv::imwrite(fname, bitmap);
 		cout << "written at " << fname << endl;
 	}
@@ -390,10 +1317,34 @@ std::vector<ZoomFrameHist> Fract::readHistFromFile(const std::string& file_path)
 	ifstream f(file_path);
 	double x1, x2, y1, y2;
 	int i = -1;
-	while (f >> x1 >> x2 >> y1 >> y2)
+	string line;
+	while (std::getline(f, line))
 	{
+		istringstream fields(line);
+		if(!(fields >> x1 >> x2 >> y1 >> y2))
+			continue;
 		++i;
 		out.emplace_back(i, x1, x2, y1, y2);
+		// optional key=value fields after the window
+		string field;
+		while(fields >> field)
+		{
+			auto eq = field.find('=');
+			if(eq == string::npos)
+				continue;
+			auto key = field.substr(0, eq);
+			auto value = field.substr(eq + 1);
+			if(key == "hpx")
+				out.back().hp_x1 = value;
+			else if(key == "hpy")
+				out.back().hp_y1 = value;
+			else if(key == "hpw")
+				out.back().hp_w = std::stod(value);
+			else if(key == "hph")
+				out.back().hp_h = std::stod(value);
+			else if(key == "it")
+				out.back().iter_max = std::stoi(value);
+		}
 	}
 	for (const auto& c: out)
 	{
@@ -452,19 +1403,6 @@ std::complex<double>  FRACTAL::CSHelper::scale(
 	return aux;
 }
 
-template <typename FROM, typename TO>
-std::pair<TO, TO> FRACTAL::CSHelper::scale(
-	CS<FROM> &src, 
-	CS<TO> &fr, 
-	std::pair<FROM, FROM> c
-) 
-{
-	return std::make_pair<TO, TO>(
-		c.first / (TO)src.width() * fr.width() + fr.x_min(),
-		c.second / (TO)src.height() * fr.height() + fr.y_min()
-	);
-}
-
 bool FRACTAL::Viewer::waitKey2Control(
         const int k,
         std::vector<FRACTAL::Viewer::KeyboardKeys>& commands
@@ -509,7 +1447,14 @@ bool FRACTAL::Viewer::waitKey2Control(
 
 cv::Mat FRACTAL::Viewer::drawWithCursor() const
 {
-	auto img2draw = this->src2view.clone();
+	cv::Mat img2draw;
+	drawWithCursor(img2draw);
+	return img2draw;
+}
+
+void FRACTAL::Viewer::drawWithCursor(cv::Mat& img2draw) const
+{
+	this->src2view.copyTo(img2draw);
 	auto half_line_width = int(src2view.size().width/this->xMod);
 	auto half_line_height = int(src2view.size().width/this->xMod);
 	try{
@@ -546,7 +1491,6 @@ cv::Mat FRACTAL::Viewer::drawWithCursor() const
 	}
 	catch(...)
 	{}
-	return img2draw;
 }
 
 void FRACTAL::Viewer::moveByKey(const std::vector<Viewer::KeyboardKeys>& keys)
@@ -7,10 +7,20 @@
 #include <vector>
 #include <chrono>
 #include <functional>
+#include <iostream>
+#include <memory>
 #include <string>
 
 #include <opencv2/core.hpp>
 
+#include "bigfixed.h"
+#include "ddouble.h"
+#include "formula.h"
+#include "kernels.h"
+#include "scheduler.h"
+#include "symmetry.h"
+#include "trace.h"
+
 
 namespace FRACTAL
 {
@@ -31,19 +41,40 @@ struct ZoomFrameHist
     {}
     int frame_number;
     double x1, x2, y1, y2;
+    //! @brief full precision x1, y1 of deep zoom frames, empty otherwise,
+    //         and the width and height, lost in x2 - x1 and y2 - y1 once
+    //         they near double epsilon
+    std::string hp_x1, hp_y1;
+    double hp_w = 0.0, hp_h = 0.0;
+    //! @brief iter_max the frame was rendered with, 0 if not recorded
+    int iter_max = 0;
     std::string info2file() const
     {
-        return cv::format("%.15f %.15f %.15f %.15f", x1, x2, y1, y2);
+        auto line = cv::format("%.15f %.15f %.15f %.15f", x1, x2, y1, y2);
+        if(!hp_x1.empty())
+            line += " hpx=" + hp_x1 + " hpy=" + hp_y1;
+        if(hp_w > 0.0)
+            line += cv::format(" hpw=%.17g", hp_w);
+        if(hp_h > 0.0)
+            line += cv::format(" hph=%.17g", hp_h);
+        if(iter_max > 0)
+            line += cv::format(" it=%d", iter_max);
+        return line;
     }
     std::string info() const
     {
-        return cv::format(
+        auto info = cv::format(
             "frame::%d\nx1(%.15f),\nx2(%.15f),\ny1(%.15f),\ny2(%.15f);",
             frame_number,
             x1,
             x2,
             y1,
             y2);
+        if(!hp_x1.empty())
+            info += "\nhpx(" + hp_x1 + "),\nhpy(" + hp_y1 + ");";
+        if(iter_max > 0)
+            info += cv::format("\nit(%d);", iter_max);
+        return info;
     }
 };
 
@@ -140,6 +171,30 @@ public:
     std::string info() const;
 };
 
+//! @brief coordinate system for zooms past double precision:
+//         the corner is kept in BigFixed, the extent in double
+struct DeepCS
+{
+    DeepCS(
+        const CS<double>& fr,
+        const int limbs
+    );
+    BigFixed x_min, y_min;
+    double width, height;
+    //! @brief same as CS::zoom, the new window is given in pixels of scr
+    void zoom(
+        const CS<int>& scr,
+        const double window_ratio,
+        const double x1,
+        const double x2,
+        const double y1
+    );
+    CS<double> toCS() const;
+    //! @brief the window in double-double, exact to ~1e-32
+    CS<DDouble> toDDCS() const;
+    double spacing(const CS<int>& scr) const { return width / scr.width(); }
+};
+
 struct Viewer
 {
     Viewer(
@@ -190,6 +245,8 @@ struct Viewer
         std::vector<Viewer::KeyboardKeys>& commands
     );
     cv::Mat drawWithCursor() const;
+    //! @brief same into img2draw, reallocated only on a size change
+    void drawWithCursor(cv::Mat& img2draw) const;
     void moveByKey(const std::vector<Viewer::KeyboardKeys>& keys);
     template <typename T>
     void moveTox1x2y1y2(
@@ -217,6 +274,161 @@ struct CSHelper
     );
 };
 
+//! @brief arithmetic a frame is rendered with
+enum class Precision
+{
+    AUTO,
+    DOUBLE,
+    DOUBLE_DOUBLE,
+    PERTURBATION
+};
+
+struct Reprojection;
+class FramePool;
+struct IterState;
+class IterDump;
+class TileCache;
+
+//! @brief switches of the render pipeline used by mandelbrot()
+struct RenderOptions
+{
+    //! @brief track the window in BigFixed; needed by the precision tiers
+    //         past double
+    bool deep_zoom = true;
+    //! @brief AUTO picks by pixel step: double down to deep_zoom_spacing,
+    //         double-double down to dd_spacing, perturbation below
+    Precision precision = Precision::AUTO;
+    double deep_zoom_spacing = 1e-15;
+    double dd_spacing = 1e-30;
+    int deep_max_references = 16;
+    //! @brief Mariani-Silver: fill rectangles with a uniform border
+    //         without iterating them, formulas whose set is connected
+    //         only (formula::Formula::connected); false evaluates every
+    //         pixel
+    bool subdivide = true;
+    int subdivide_min = 4;
+    //! @brief copy the pixels mirrored about the real axis (Mandelbrot
+    //         like formulas) or about 0 (their Julia sets) instead of
+    //         iterating them, see symmetry.h; double and double-double
+    //         frames whose axis falls on the pixel grid
+    bool symmetry = true;
+    //! @brief render threads, 0 = all cores; tile side in pixels, 64x64
+    //         counts fit in L1/L2 next to the kernel state
+    int threads = 0;
+    int tile = 64;
+    //! @brief coarse-to-fine: passes over 1/16 and 1/4 of the pixels before
+    //         the full one, each reusing the samples of the previous pass;
+    //         preview(colors, stride) sees every coarse pass, blocks of
+    //         stride x stride pixels filled with their sample
+    bool progressive = false;
+    std::function<void(const std::vector<int>& colors, const int stride)> preview;
+    //! @brief previous frame mapped to this one (reproject.h): its exact
+    //         counts are not iterated again, its hints order the tiles;
+    //         mandelbrot() sets it for every frame after the first if
+    //         reproject is on
+    std::shared_ptr<const Reprojection> reprojection;
+    bool reproject = true;
+    //! @brief z of every pixel where its orbit stopped (iterstate.h): a
+    //         render of the window it was left for only continues the
+    //         unescaped pixels; simd kernel path only. mandelbrot() keeps
+    //         one across frames with keep_state, 21 bytes a pixel
+    std::shared_ptr<IterState> state;
+    bool keep_state = false;
+    //! @brief quadtree tile cache (tilecache.h): a window on its grid is
+    //         put together from cached tiles, the missing ones rendered;
+    //         simd kernel path only, without progressive passes or
+    //         reprojection. Unless one is given, mandelbrot() makes one of
+    //         cache_tiles tiles (0 = none), mapped from outDir/tiles too
+    //         with cache_disk, and only then snaps its windows to the grid
+    std::shared_ptr<TileCache> cache;
+    size_t cache_tiles = 0;
+    bool cache_disk = false;
+    //! @brief checked by the scheduler before every tile (scheduler.h);
+    //         a cancelled render returns early with colors incomplete
+    std::shared_ptr<const CancelToken> cancel;
+    bool cancelled() const { return cancel && cancel->cancelled(); }
+    //! @brief mandelbrot() writes its frames on writers encoder threads
+    //         (imagewriter.h), 0 = all cores, while the next frame renders;
+    //         rendering waits once write_queue frames are queued
+    int writers = 2;
+    size_t write_queue = 4;
+    //! @brief stream the frames of mandelbrot() into one video instead
+    //         of a png each (framesink.h): a file under outDir, .y4m or
+    //         anything cv::VideoWriter takes, or "|command" reading y4m
+    //         on stdin; empty = png files
+    std::string video;
+    double video_fps = 30.0;
+    //! @brief mandelbrot() also keeps the counts of every frame as
+    //         mandelbrot.%03d.fiter (iterdump.h), to re-color later
+    //         (fractal_recolor); dump_smooth adds fractional counts,
+    //         double precision frames only. Not the frames shaded by
+    //         distance_estimate, whose filled blocks have no counts of
+    //         their own
+    bool dump_iters = false;
+    bool dump_smooth = false;
+    //! @brief 16-bit counts and an interior mask in the dump when
+    //         iter_max fits (compactcounts.h), half the file
+    bool dump_compact = true;
+    //! @brief buffers recycled between frames (framepool.h): plot takes
+    //         its bitmap from it; mandelbrot() makes one unless given
+    std::shared_ptr<FramePool> pool;
+    //! @brief mandelbrot() records spans of its stages (trace.h): the
+    //         chrome trace goes to this file under outDir on return, the
+    //         summary to stdout; empty = no tracing
+    std::string trace;
+    //! @brief adaptive anti-aliasing (antialias.h) of the frames of
+    //         mandelbrot() and computeFrame: pixels whose color differs
+    //         from a neighbour's by more than aa_threshold (0..255, any
+    //         channel) take one jittered sample, then up to aa_samples
+    //         four a round, until a round moves their color by less than
+    //         aa_tolerance; aa_samples 0 = off, double precision frames
+    //         only. The samples take at most aa_budget times the
+    //         iterations of the frame, the pixels that disagree most
+    //         first; aa_budget 0 = no limit
+    int aa_samples = 0;
+    int aa_threshold = 24;
+    double aa_tolerance = 2.0;
+    double aa_budget = 0.25;
+    //! @brief distance estimation (distance.h): mandelbrot() and
+    //         computeFrame shade every pixel by its distance to the
+    //         boundary instead of its count, dark within de_thickness
+    //         pixels of it, the interior black. With de_fill a block of
+    //         pixels all further than 4 times that from the boundary by
+    //         the bound of one corner is filled without iterating it, as
+    //         interior blocks are with subdivide. The anti-aliasing also
+    //         resamples the pixels the boundary passes through. Double
+    //         precision frames only, the others keep the palette
+    bool distance_estimate = false;
+    double de_thickness = 2.0;
+    bool de_fill = true;
+    //! @brief mandelbrot() picks iter_max for every new window instead of
+    //         keeping the one set: the window is probed on a grid of
+    //         auto_iter_probe points across, with a cap grown from the
+    //         zoom depth, and gets the smallest iter_max leaving under
+    //         auto_iter_tail of the points black that would escape later,
+    //         within [auto_iter_min, auto_iter_max]; logged as it= in the
+    //         history. The probe runs in the render job, cancelled with
+    //         it. The iteration keys still override it per window, past
+    //         auto_iter_max too
+    bool auto_iter = false;
+    int auto_iter_min = 100;
+    int auto_iter_max = 1 << 15;
+    int auto_iter_probe = 48;
+    double auto_iter_tail = 0.002;
+    Precision precisionFor(const double spacing) const
+    {
+        if(!deep_zoom)
+            return Precision::DOUBLE;
+        if(precision != Precision::AUTO)
+            return precision;
+        if(spacing >= deep_zoom_spacing)
+            return Precision::DOUBLE;
+        return spacing >= dd_spacing 
+            ? Precision::DOUBLE_DOUBLE 
+            : Precision::PERTURBATION;
+    }
+};
+
 struct Fract
 {
     Fract(
@@ -224,6 +436,56 @@ struct Fract
     );
     std::string outDir = "";
     typedef std::complex<double> Complex;
+
+    typedef FRACTAL::Precision Precision;
+    typedef FRACTAL::RenderOptions RenderOptions;
+    RenderOptions options;
+
+    //! @brief writes out[k] for the pixels (xs[k], ys[k]), k in [0, n)
+    typedef std::function<void(const int* xs, const int* ys, int n, int* out)> PixelEval;
+    //! @brief fill colors through eval, all pixels or by subdivision
+    //         as opts says (see subdivide.h), on opts.threads threads
+    //         (see scheduler.h); pixels mirrored by symmetry are copied
+    static void renderPixels(
+        const CS<int> &scr,
+        std::vector<int> &colors,
+        const PixelEval &eval,
+        const RenderOptions &opts,
+        const Symmetry &symmetry = Symmetry()
+    );
+    //! @brief same for the pixels of region only, clipped to scr; the
+    //         rest of colors is left as is
+    static void renderPixels(
+        const CS<int> &scr,
+        const CS<int> &region,
+        std::vector<int> &colors,
+        const PixelEval &eval,
+        const RenderOptions &opts,
+        const Symmetry &symmetry = Symmetry()
+    );
+    //! @brief the symmetry of formula F in the window fract, NONE unless
+    //         opts.symmetry
+    template <typename F, typename T>
+    static Symmetry symmetryOf(
+        const CS<int> &scr,
+        const CS<T> &fract,
+        const RenderOptions &opts
+    );
+
+    //! @brief run eval over the tiles of rc, costly first (scheduler.h);
+    //         with stride > 1 renders the coarse image of every tile in
+    //         stride x stride blocks and replaces cost by its slowest sample
+    static void renderTiles(
+        const CS<int> &scr,
+        const cv::Rect &rc,
+        const std::vector<cv::Rect> &tiles,
+        std::vector<double> &cost,
+        std::vector<int> &colors,
+        const PixelEval &eval,
+        const RenderOptions &opts,
+        const int stride = 1
+    );
+
     std::vector<ZoomFrameHist> readHistFromFile(const std::string& file_path);
     
     //! @brief loop over each pixel from our image and check 
@@ -237,6 +499,36 @@ struct Fract
             std::complex<double>, std::complex<double>
         )> &func);
 
+    //! @brief compile-time formula, see formula.h, on any real type T
+    //         (double, DDouble); the std::function overload above stays
+    //         as the slow path for custom lambdas
+    template <typename F, typename T, std::enable_if_t<formula::IsFormula<F>::value, int> = 0>
+    static void getNumberIterations(
+        CS<int> &scr, 
+        CS<T> &fract, 
+        int iter_max, 
+        std::vector<int> &colors,
+        const F &f,
+        const RenderOptions &opts = RenderOptions());
+
+    //! @brief built-in z*z + c: same counts as the generic formula,
+    //         rows go through the simd kernel
+    static void getNumberIterations(
+        CS<int> &scr, 
+        CS<double> &fract, 
+        int iter_max, 
+        std::vector<int> &colors,
+        const formula::Mandelbrot &f,
+        const RenderOptions &opts = RenderOptions());
+
+    //! @brief z*z + c past double precision, see perturb.h
+    static void getNumberIterations(
+        CS<int> &scr, 
+        const DeepCS &fract, 
+        int iter_max, 
+        std::vector<int> &colors,
+        const RenderOptions &opts = RenderOptions());
+
     //! @brief check if a point is in the set or escapes to infinity, 
     //         return the number if iterations
     static int escape(
@@ -263,6 +555,100 @@ struct Fract
         const bool write=true
     );
 
+    template <typename F, typename T, std::enable_if_t<formula::IsFormula<F>::value, int> = 0>
+    static cv::Mat computeFractal(
+        CS<int> &scr, 
+        CS<T> &fract, 
+        int iter_max, 
+        std::vector<int> &colors,
+        const F &f, 
+        const char *fname, 
+        bool smooth_color,
+        const bool show=false,
+        const bool write=true,
+        const RenderOptions &opts = RenderOptions()
+    );
+
+    static cv::Mat computeFractal(
+        CS<int> &scr, 
+        const DeepCS &fract, 
+        int iter_max, 
+        std::vector<int> &colors,
+        const char *fname, 
+        bool smooth_color,
+        const bool show=false,
+        const bool write=true,
+        const RenderOptions &opts = RenderOptions()
+    );
+
+    //! @brief counts of the window of a history frame (readHistFromFile)
+    //         at the resolution of scr, x1..x2 across, taken from
+    //         hpx/hpy/hpw when it has them; precision as opts picks for
+    //         its pixel step, returned
+    static Precision countFrame(
+        CS<int> &scr, 
+        const ZoomFrameHist &frame, 
+        int iter_max, 
+        std::vector<int> &colors,
+        const RenderOptions &opts = RenderOptions()
+    );
+    //! @brief same, colored; nothing shown or written
+    static cv::Mat computeFrame(
+        CS<int> &scr, 
+        const ZoomFrameHist &frame, 
+        int iter_max, 
+        std::vector<int> &colors,
+        bool smooth_color,
+        const RenderOptions &opts = RenderOptions()
+    );
+    //! @brief iter_max for the window fract at the resolution of scr,
+    //         depth = log2 of the zoom from the first frame; see
+    //         RenderOptions::auto_iter
+    static int autoIterMax(
+        const CS<int> &scr, 
+        const DeepCS &fract, 
+        const double depth,
+        const RenderOptions &opts
+    );
+
+    //! @brief the window of a history frame in double: the recorded one
+    //         widened to scr's aspect about its centre
+    static CS<double> frameWindow(
+        const CS<int> &scr, 
+        const ZoomFrameHist &frame
+    );
+
+    //! @brief resample the edge pixels of bitmap, colored from the
+    //         Mandelbrot counts of fract, as opts.aa_samples asks
+    //         (antialias.h); nothing if it is 0
+    static void antiAlias(
+        const CS<int> &scr, 
+        const CS<double> &fract, 
+        const std::vector<int> &colors,
+        int iter_max,
+        bool smooth_color,
+        cv::Mat &bitmap,
+        const RenderOptions &opts
+    );
+
+    //! @brief Mandelbrot counts of fract and their picture shaded by the
+    //         distance to the boundary (distance.h), anti-aliased as
+    //         opts.aa_samples asks; the bitmap from opts.pool if set
+    static cv::Mat distanceFractal(
+        CS<int> &scr, 
+        CS<double> &fract, 
+        int iter_max, 
+        std::vector<int> &colors,
+        const char *fname, 
+        const bool write,
+        const RenderOptions &opts
+    );
+
+    static void printGenerateTime(
+        const char *fname,
+        const std::chrono::steady_clock::time_point& start
+    );
+
     static std::tuple<int, int, int> iters2rgbBernstein(
         const int n, 
         const int iter_max,
@@ -283,6 +669,7 @@ struct Fract
         const bool write=true
     );
 
+    //! @brief colors through the palette, the bitmap from pool if given
     static cv::Mat plot(
         CS<int> &scr, 
         std::vector<int> &colors, 
@@ -290,10 +677,103 @@ struct Fract
         const char *fname, 
         bool smooth_color,
         const bool show=false,
-        const bool write=true
+        const bool write=true,
+        FramePool* pool=nullptr
+    );
+    //! @brief colors of a dump (iterdump.h) straight from its mapping;
+    //         its smooth counts when it has them and smooth_counts is set
+    static cv::Mat plot(
+        const IterDump &dump, 
+        bool smooth_color,
+        const bool smooth_counts=true
     );
 };
 
+template <typename FROM, typename TO>
+std::pair<TO, TO> CSHelper::scale(
+    CS<FROM> &src, 
+    CS<TO> &fr, 
+    std::pair<FROM, FROM> c
+) 
+{
+    return std::make_pair<TO, TO>(
+        c.first / (TO)src.width() * fr.width() + fr.x_min(),
+        c.second / (TO)src.height() * fr.height() + fr.y_min()
+    );
+}
+
+template <typename F, typename T>
+Symmetry Fract::symmetryOf(
+    const CS<int> &scr,
+    const CS<T> &fract,
+    const RenderOptions &opts
+)
+{
+    if(!opts.symmetry)
+        return Symmetry();
+    // in T: past double the window corner is far bigger than a pixel
+    return Symmetry::of<F>(
+        static_cast<double>(-fract.x_min()*T(scr.width())/fract.width()),
+        static_cast<double>(-fract.y_min()*T(scr.height())/fract.height())
+    );
+}
+
+template <typename F, typename T, std::enable_if_t<formula::IsFormula<F>::value, int>>
+void Fract::getNumberIterations(
+    CS<int> &src, 
+    CS<T> &fract, 
+    int iter_max, 
+    std::vector<int> &colors,
+    const F &f,
+    const RenderOptions &opts
+)
+{
+    const double tol = kernels::periodicityTol(static_cast<double>(fract.width())/src.width());
+    const auto symmetry = symmetryOf<F>(src, fract, opts);
+    // a uniform border would paint over the islands of a set that is not
+    // connected
+    RenderOptions options = opts;
+    options.subdivide = opts.subdivide && F::connected;
+    renderPixels(
+        src,
+        colors,
+        [&src, &fract, &f, &iter_max, &tol](const int* xs, const int* ys, int n, int* out) -> void
+        {
+            for(int k = 0; k < n; ++k)
+            {
+                auto c = CSHelper::scale<int, T>(src, fract, {xs[k], ys[k]});
+                out[k] = formula::escape(f, c.first, c.second, iter_max, 2.0, tol);
+            }
+        },
+        options,
+        symmetry
+    );
+}
+
+template <typename F, typename T, std::enable_if_t<formula::IsFormula<F>::value, int>>
+cv::Mat Fract::computeFractal(
+    CS<int> &src, 
+    CS<T> &fract, 
+    int iter_max, 
+    std::vector<int> &colors,
+    const F &f, 
+    const char *fname, 
+    bool smooth_color,
+    const bool show,
+    const bool write,
+    const RenderOptions &opts
+)
+{
+    std::cout << "computeFractal..." << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    {
+        Trace::Span span("compute");
+        getNumberIterations(src, fract, iter_max, colors, f, opts);
+    }
+    printGenerateTime(fname, start);
+    return Fract::plot(src, colors, iter_max, fname, smooth_color, show, write, opts.pool.get());
+}
+
 } // namespace FRACT
 
 #endif //FRACT__H
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "fract.h"
+#include "framepool.h"
+#include "imagewriter.h"
+#include "scheduler.h"
+#include "tools.h"
+#include "trace.h"
+
+using namespace std;
+
+//! @brief renders every frame of a recorded zoom, no window, e.g.
+//         fractal_batch mandelbrot.fhistory out 3840 2160 2000
+//         frames already in out are skipped, so a stopped run resumes
+int main(int argc, char** argv) 
+{
+	if(argc < 3)
+	{
+		cout << "usage: " << argv[0]
+			 << " <history.fhistory> <out_dir> [width=3840] [height=2160]"
+			 << " [max_iter=0 (from the history, else 500)] [frames_in_flight=0 (auto)] [trace.json] [aa_samples=0]"
+			 << " [distance_estimate=0]" << endl;
+		return 1;
+	}
+	const string hist_path(argv[1]);
+	const string out_dir(argv[2]);
+	const int w_out = argc > 3 ? stoi(argv[3]) : 3840;
+	const int h_out = argc > 4 ? stoi(argv[4]) : 2160;
+	// 0: each frame at the iter_max it was rendered with (it= in the
+	// history), 500 for frames without one
+	const int max_iter = argc > 5 ? stoi(argv[5]) : 0;
+	int in_flight = argc > 6 ? stoi(argv[6]) : 0;
+	const string trace_path = argc > 7 ? argv[7] : "";
+	const int aa_samples = argc > 8 ? stoi(argv[8]) : 0;
+	const bool distance_estimate = argc > 9 && stoi(argv[9]) != 0;
+	if(w_out < 1 || h_out < 1 || max_iter < 0)
+		throw std::runtime_error("fractal_batch: bad resolution or max_iter");
+
+	FRACTAL::Fract fractal(out_dir);
+	const auto frames = fractal.readHistFromFile(hist_path);
+	if(frames.empty())
+		throw std::runtime_error("fractal_batch: no frames in " + hist_path);
+	string fname_pr = "mandelbrot.%03d.png";
+	std::vector<size_t> todo;
+	for(size_t i = 0; i < frames.size(); ++i)
+	{
+		auto f_path = FRACTAL::join(out_dir, cv::format(fname_pr.c_str(), frames[i].frame_number));
+		if(FRACTAL::isFileExist(f_path))
+			cout << "exists, skipped " << f_path << endl;
+		else
+			todo.push_back(i);
+	}
+	cout << todo.size() << "/" << frames.size() << " frames to render" << endl;
+
+	// a frame spreads over its tiles; when it has too few to keep every
+	// core busy (small frames, serial reference orbits past double), the
+	// cores are split among several frames rendered at once
+	const int cores = FRACTAL::Scheduler::threads(fractal.options.threads);
+	if(in_flight < 1)
+	{
+		const int tile = std::max(fractal.options.tile, 1);
+		const int tiles = ((w_out + tile - 1)/tile)*((h_out + tile - 1)/tile);
+		// a few tiles per thread are needed to balance uneven ones
+		const int threads_per_frame = std::max(1, std::min(cores, tiles/4));
+		in_flight = std::max(1, cores/threads_per_frame);
+	}
+	in_flight = std::max(1, std::min<int>(in_flight, todo.size()));
+	FRACTAL::RenderOptions options = fractal.options;
+	options.threads = std::max(1, cores/in_flight);
+	options.progressive = false;
+	options.aa_samples = aa_samples;
+	options.distance_estimate = distance_estimate;
+	// bitmaps come back once the writer is done with them
+	options.pool = std::make_shared<FRACTAL::FramePool>(in_flight + options.write_queue);
+	cout << "frames in flight " << in_flight 
+		 << ", threads per frame " << options.threads << endl;
+
+	if(!trace_path.empty())
+		FRACTAL::Trace::enable();
+	std::atomic<size_t> next(0);
+	FRACTAL::ImageWriter writer(options.writers, options.write_queue);
+	auto render = [&]() -> void
+	{
+		std::vector<int> colors;
+		FRACTAL::CS<int> src(0, w_out, 0, h_out);
+		for(size_t k = next++; k < todo.size(); k = next++)
+		{
+			const auto& frame = frames[todo[k]];
+			auto f_path = FRACTAL::join(out_dir, cv::format(fname_pr.c_str(), frame.frame_number));
+			colors.assign(src.size(), 0);
+			FRACTAL::Trace::Span span("frame");
+			span.arg("frame", frame.frame_number);
+			try
+			{
+				writer.write(
+					f_path,
+					FRACTAL::Fract::computeFrame(
+						src,
+						frame,
+						max_iter > 0 ? max_iter : frame.iter_max > 0 ? frame.iter_max : 500,
+						colors,
+						true,
+						options
+					)
+				);
+			}
+			catch(const std::exception& e)
+			{
+				// the others still render; a rerun retries this one
+				cout << "failed " << f_path << "::" << e.what() << endl;
+			}
+		}
+	};
+	std::vector<std::thread> pool;
+	for(int t = 1; t < in_flight; ++t)
+		pool.emplace_back(render);
+	render();
+	for(auto& th : pool)
+		th.join();
+	writer.flush();
+	cout << writer.stats().info() << endl;
+	if(!trace_path.empty())
+	{
+		FRACTAL::Trace::write(trace_path);
+		cout << FRACTAL::Trace::summary() << endl;
+	}
+	return 0;
+}
@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "distance.h"
+#include "fract.h"
+#include "kernels.h"
+#include "palette.h"
+#include "tools.h"
+#include "trace.h"
+
+using namespace std;
+
+namespace
+{
+//! @brief a fixed window, corner x1, y1 and width; hp_x1, hp_y1 past
+//         double precision
+struct Scene
+{
+	string name;
+	FRACTAL::ZoomFrameHist frame;
+};
+
+std::vector<Scene> scenes()
+{
+	auto window = [](const double x1, const double y1, const double width) -> FRACTAL::ZoomFrameHist
+	{
+		return FRACTAL::ZoomFrameHist(0, x1, x1 + width, y1, y1 + width);
+	};
+	FRACTAL::ZoomFrameHist deep(0, -0.743643887037159, -0.743643887037159, 0.131825904205330, 0.131825904205330);
+	deep.hp_x1 = "-0.74364388703715870475219150611477";
+	deep.hp_y1 = "0.13182590420532979";
+	deep.hp_w = 1e-22;
+	return {
+		// the whole set
+		{"full", window(-2.2, -1.7, 3.4)},
+		// the windows kept in fract_go.cpp
+		{"seahorse", window(-0.562202623667693, -0.642817157614104, 1.0701458e-8)},
+		{"petlya", window(-0.748691950590000, -0.084454610590000, 1.9941e-6)},
+		// inside the period 3 minibrot: every pixel runs to iter_max
+		// unless the periodicity check proves it
+		{"interior", window(-1.7548776662466927 - 2e-4, -2e-4, 4e-4)},
+		// seahorse valley: filaments everywhere, little to subdivide
+		{"boundary", window(-0.743643887037151 - 5e-5, 0.131825904205330 - 5e-5, 1e-4)},
+		// past double: perturbation
+		{"deep", deep}
+	};
+}
+
+const char* precisionName(const FRACTAL::Precision precision)
+{
+	switch(precision)
+	{
+		case FRACTAL::Precision::DOUBLE_DOUBLE: return "double_double";
+		case FRACTAL::Precision::PERTURBATION: return "perturbation";
+		default: return "double";
+	}
+}
+
+std::vector<int> parseInts(const string& list)
+{
+	std::vector<int> out;
+	istringstream fields(list);
+	string field;
+	while(std::getline(fields, field, ','))
+		out.push_back(stoi(field));
+	return out;
+}
+
+std::vector<string> parseNames(const string& list)
+{
+	std::vector<string> out;
+	istringstream fields(list);
+	string field;
+	while(std::getline(fields, field, ','))
+		out.push_back(field);
+	return out;
+}
+
+double msSince(const std::chrono::steady_clock::time_point& start)
+{
+	return std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start
+	).count();
+}
+} // namespace
+
+//! @brief renders the canonical scenes over sizes x iter_max x threads x
+//         kernels and appends one json object per run to --out, e.g.
+//         fractal_bench --sizes=1024,2048 --iters=1000 --threads=1,0
+//         Times are the best of --reps runs; render, coloring and png
+//         writing (--io-dir, empty to skip) are reported apart. The
+//         checksum of the counts tells a wrong count from a slow one;
+//         --trace writes the spans of every run (trace.h) as well;
+//         --aa=n times adaptive anti-aliasing of double frames (aa_ms),
+//         --de renders and colors double frames by distance estimation.
+int main(int argc, char** argv) 
+{
+	string out_path = "fractal_bench.jsonl";
+	string io_dir = "";
+	string trace_path = "";
+	int aa_samples = 0;
+	bool distance_estimate = false;
+	std::vector<string> scene_names;
+	std::vector<int> sizes{512, 1024, 2048};
+	std::vector<int> iters{500, 5000};
+	std::vector<int> threads{1, 0};
+	std::vector<string> isas{FRACTAL::kernels::isaName(FRACTAL::kernels::bestIsa())};
+	int reps = 3;
+	for(int a = 1; a < argc; ++a)
+	{
+		const string arg(argv[a]);
+		const auto eq = arg.find('=');
+		const string key = arg.substr(0, eq);
+		const string value = eq == string::npos ? "" : arg.substr(eq + 1);
+		if(key == "--out")
+			out_path = value;
+		else if(key == "--io-dir")
+			io_dir = value;
+		else if(key == "--trace")
+			trace_path = value;
+		else if(key == "--aa")
+			aa_samples = std::max(0, stoi(value));
+		else if(key == "--de")
+			distance_estimate = value.empty() || stoi(value) != 0;
+		else if(key == "--scenes")
+			scene_names = parseNames(value);
+		else if(key == "--sizes")
+			sizes = parseInts(value);
+		else if(key == "--iters")
+			iters = parseInts(value);
+		else if(key == "--threads")
+			threads = parseInts(value);
+		else if(key == "--isa")
+			isas = parseNames(value);
+		else if(key == "--reps")
+			reps = std::max(1, stoi(value));
+		else if(key == "--quick")
+		{
+			sizes = {512};
+			iters = {500};
+			threads = {0};
+			reps = 1;
+		}
+		else
+		{
+			cout << "usage: " << argv[0]
+				 << " [--scenes=full,seahorse,petlya,interior,boundary,deep]"
+				 << " [--sizes=512,1024,2048] [--iters=500,5000] [--threads=1,0]"
+				 << " [--isa=scalar,sse2,avx2,avx512] [--reps=3] [--quick]"
+				 << " [--out=fractal_bench.jsonl] [--io-dir=dir] [--trace=trace.json] [--aa=16] [--de]" << endl;
+			return 1;
+		}
+	}
+	if(!io_dir.empty() && !FRACTAL::mkdir(io_dir))
+		throw std::runtime_error("fractal_bench: cannot create " + io_dir);
+	if(!trace_path.empty())
+		FRACTAL::Trace::enable();
+
+	std::vector<Scene> runs;
+	for(const auto& scene : scenes())
+	{
+		if(scene_names.empty()
+			|| std::find(scene_names.begin(), scene_names.end(), scene.name) != scene_names.end())
+			runs.push_back(scene);
+	}
+	ofstream out(out_path, std::ios::app);
+	std::vector<string> table;
+	for(const auto& isa_name : isas)
+	{
+		auto isa = FRACTAL::kernels::Isa::SCALAR;
+		for(int k = 0; k <= static_cast<int>(FRACTAL::kernels::Isa::AVX512); ++k)
+		{
+			if(isa_name == FRACTAL::kernels::isaName(static_cast<FRACTAL::kernels::Isa>(k)))
+				isa = static_cast<FRACTAL::kernels::Isa>(k);
+		}
+		// clamped to what the cpu runs
+		isa = FRACTAL::kernels::setIsa(isa);
+		for(const auto& scene : runs)
+		for(const int size : sizes)
+		for(const int iter_max : iters)
+		for(const int requested : threads)
+		{
+			FRACTAL::CS<int> src(0, size, 0, size);
+			FRACTAL::RenderOptions options;
+			options.threads = requested;
+			options.aa_samples = aa_samples;
+			options.distance_estimate = distance_estimate;
+			std::vector<int> colors(src.size());
+			std::vector<float> distance;
+			cv::Mat bitmap;
+			double render_ms = 1e300, color_ms = 1e300, aa_ms = 0.0, io_ms = 0.0;
+			const auto window = FRACTAL::Fract::frameWindow(src, scene.frame);
+			auto precision = FRACTAL::Precision::DOUBLE;
+			// distance frames only in double, the others keep the counts
+			const bool de = distance_estimate
+				&& options.precisionFor(window.width()/size) == FRACTAL::Precision::DOUBLE;
+			for(int r = 0; r < reps; ++r)
+			{
+				std::fill(colors.begin(), colors.end(), 0);
+				auto start = std::chrono::steady_clock::now();
+				if(de)
+					FRACTAL::DistanceEstimate::render(src, window, iter_max, colors, distance, options);
+				else
+					precision = FRACTAL::Fract::countFrame(src, scene.frame, iter_max, colors, options);
+				render_ms = std::min(render_ms, msSince(start));
+				start = std::chrono::steady_clock::now();
+				if(de)
+					FRACTAL::DistanceEstimate::colorize(colors, distance, size, size, iter_max, options.de_thickness, bitmap);
+				else
+					FRACTAL::Palette::forSmooth(true).colorize(colors, size, size, iter_max, bitmap);
+				color_ms = std::min(color_ms, msSince(start));
+				if(aa_samples < 1 || precision != FRACTAL::Precision::DOUBLE)
+					continue;
+				start = std::chrono::steady_clock::now();
+				if(de)
+					FRACTAL::DistanceEstimate::antiAlias(src, window, colors, distance, iter_max, bitmap, options);
+				else
+					FRACTAL::Fract::antiAlias(src, window, colors, iter_max, true, bitmap, options);
+				aa_ms = r == 0 ? msSince(start) : std::min(aa_ms, msSince(start));
+			}
+			if(!io_dir.empty())
+			{
+				auto start = std::chrono::steady_clock::now();
+				cv::imwrite(FRACTAL::join(io_dir, scene.name + ".png"), bitmap);
+				io_ms = msSince(start);
+			}
+			// escape-time iterations the frame stands for: the sum of its
+			// counts, whatever subdivision or the interior checks saved
+			double iterations = 0.0;
+			size_t interior = 0;
+			uint64_t checksum = 1469598103934665603ull;
+			for(const int c : colors)
+			{
+				iterations += c;
+				interior += c >= iter_max;
+				checksum = (checksum ^ static_cast<uint32_t>(c))*1099511628211ull;
+			}
+			const double pixels = static_cast<double>(src.size());
+			auto line = cv::format(
+				"{\"scene\":\"%s\",\"width\":%d,\"height\":%d,\"iter_max\":%d,"
+				"\"threads\":%d,\"isa\":\"%s\",\"precision\":\"%s\",\"distance\":%s,"
+				"\"render_ms\":%.3f,\"color_ms\":%.3f,\"aa_ms\":%.3f,\"io_ms\":%.3f,"
+				"\"pixels_per_s\":%.0f,\"iters_per_s\":%.0f,"
+				"\"interior\":%.4f,\"checksum\":\"%016llx\"}",
+				scene.name.c_str(),
+				size,
+				size,
+				iter_max,
+				FRACTAL::Scheduler::threads(requested),
+				FRACTAL::kernels::isaName(isa),
+				precisionName(precision),
+				de ? "true" : "false",
+				render_ms,
+				color_ms,
+				aa_ms,
+				io_ms,
+				pixels/(render_ms*1e-3),
+				iterations/(render_ms*1e-3),
+				interior/pixels,
+				static_cast<unsigned long long>(checksum)
+			);
+			out << line << endl;
+			table.push_back(cv::format(
+				"%-9s %5d %6d %3d %-7s %-13s %10.2f %8.2f %8.2f %8.2f %8.2f %10.1f",
+				scene.name.c_str(),
+				size,
+				iter_max,
+				FRACTAL::Scheduler::threads(requested),
+				FRACTAL::kernels::isaName(isa),
+				precisionName(precision),
+				render_ms,
+				color_ms,
+				aa_ms,
+				io_ms,
+				pixels/(render_ms*1e3),
+				iterations/(render_ms*1e3)
+			));
+		}
+	}
+	FRACTAL::kernels::setIsa(FRACTAL::kernels::bestIsa());
+	cout << "scene      size  iters thr isa     precision      render ms color ms    aa ms    io ms     Mpx/s    Miter/s" << endl;
+	for(const auto& row : table)
+		cout << row << endl;
+	cout << "appended " << table.size() << " runs to " << out_path << endl;
+	if(!trace_path.empty())
+	{
+		FRACTAL::Trace::write(trace_path);
+		cout << FRACTAL::Trace::summary() << endl;
+	}
+	return 0;
+}
@@ -52,6 +52,12 @@ int main()
 	int max_iter(200);
 	const bool show=true;
 	const bool write=true;
+	// iter_max picked for every window from a probe of it, no less
+	// than max_iter; the iteration keys still step it
+	fractal.options.auto_iter = true;
+	fractal.options.auto_iter_min = max_iter;
+	// a raise of iter_max continues the orbits left unescaped
+	fractal.options.keep_state = true;
 	fractal.mandelbrot(
 		{x1, y1},
 		{x2, y2},
@@ -0,0 +1,54 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <opencv2/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "fract.h"
+#include "iterdump.h"
+
+using namespace std;
+
+//! @brief re-colors a frame from its .fiter dump without iterating, e.g.
+//         fractal_recolor mandelbrot.007.fiter mandelbrot.007.png linear
+int main(int argc, char** argv) 
+{
+	if(argc < 3)
+	{
+		cout << "usage: " << argv[0]
+			 << " <frame.fiter> <out.png> [poly|linear] [smooth=1]" << endl;
+		return 1;
+	}
+	const string in(argv[1]);
+	const string out(argv[2]);
+	const bool smooth_color = argc > 3 ? string(argv[3]) != "linear" : true;
+	const bool smooth_counts = argc > 4 ? string(argv[4]) != "0" : true;
+
+	auto start = std::chrono::steady_clock::now();
+	FRACTAL::IterDump dump(in);
+	auto window = dump.window();
+	cout << cv::format(
+		"%s: %dx%d iter_max %d formula %d%s%s {%.15f, %.15f, %.15f, %.15f}",
+		in.c_str(),
+		dump.width(),
+		dump.height(),
+		dump.iterMax(),
+		dump.formula(),
+		dump.counts16() ? " 16-bit" : "",
+		dump.smooth() ? " smooth" : "",
+		window.x_min(),
+		window.y_min(),
+		window.x_max(),
+		window.y_max()
+	) << endl;
+	auto bitmap = FRACTAL::Fract::plot(dump, smooth_color, smooth_counts);
+	FRACTAL::Fract::printGenerateTime(out.c_str(), start);
+	if(!cv::imwrite(out, bitmap))
+	{
+		cout << "cannot write " << out << endl;
+		return 1;
+	}
+	cout << "written at " << out << endl;
+	return 0;
+}
@@ -0,0 +1,121 @@
+#include <algorithm>
+
+#include "framepool.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+namespace
+{
+//! @brief no cv::Mat but the one in the pool shares the buffer
+bool unshared(const cv::Mat& m)
+{
+	return m.u && CV_XADD(&m.u->refcount, 0) == 1;
+}
+} // namespace
+
+std::string FRACTAL::FramePool::Stats::info() const
+{
+	return cv::format(
+		"FramePool::hits %zu misses %zu held %.1f MB",
+		hits,
+		misses,
+		bytes/1048576.0
+	);
+}
+
+FRACTAL::FramePool::FramePool(const size_t max_free)
+: _max_free(std::max<size_t>(max_free, 1))
+{}
+
+FramePool::Counts FRACTAL::FramePool::counts(const size_t n)
+{
+	std::unique_ptr<std::vector<int>> buffer;
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		// the smallest idle buffer that holds n, no reallocation
+		auto best = _counts.end();
+		for(auto it = _counts.begin(); it != _counts.end(); ++it)
+		{
+			if((*it)->capacity() >= n
+				&& (best == _counts.end() || (*it)->capacity() < (*best)->capacity()))
+				best = it;
+		}
+		if(best != _counts.end())
+		{
+			buffer = std::move(*best);
+			_counts.erase(best);
+			++_stats.hits;
+		}
+		else
+		{
+			buffer.reset(new std::vector<int>());
+			++_stats.misses;
+			_stats.bytes += n*sizeof(int);
+		}
+	}
+	buffer->assign(n, 0);
+	std::weak_ptr<FramePool> pool = shared_from_this();
+	return Counts(
+		buffer.release(),
+		[pool](std::vector<int>* released) -> void
+		{
+			if(auto owner = pool.lock())
+				owner->recycle(released);
+			else
+				delete released;
+		}
+	);
+}
+
+void FRACTAL::FramePool::recycle(std::vector<int>* buffer)
+{
+	std::unique_ptr<std::vector<int>> owned(buffer);
+	std::lock_guard<std::mutex> lock(_lock);
+	if(_counts.size() >= _max_free)
+	{
+		_stats.bytes -= owned->capacity()*sizeof(int);
+		return;
+	}
+	_counts.push_back(std::move(owned));
+}
+
+cv::Mat FRACTAL::FramePool::image(const int rows, const int cols, const int type)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	size_t idle = 0;
+	for(auto it = _images.begin(); it != _images.end(); ++it)
+	{
+		if(!unshared(*it))
+			continue;
+		if(it->rows == rows && it->cols == cols && it->type() == type)
+		{
+			++_stats.hits;
+			return *it;
+		}
+		++idle;
+	}
+	// idle buffers of other sizes beyond max_free are dropped
+	for(auto it = _images.begin(); idle >= _max_free && it != _images.end();)
+	{
+		if(unshared(*it))
+		{
+			_stats.bytes -= it->total()*it->elemSize();
+			it = _images.erase(it);
+			--idle;
+		}
+		else
+			++it;
+	}
+	++_stats.misses;
+	cv::Mat fresh(rows, cols, type);
+	_stats.bytes += fresh.total()*fresh.elemSize();
+	_images.push_back(fresh);
+	return fresh;
+}
+
+FramePool::Stats FRACTAL::FramePool::stats() const
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _stats;
+}
@@ -0,0 +1,57 @@
+#ifndef FRACT_FRAMEPOOL_H
+#define FRACT_FRAMEPOOL_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace FRACTAL
+{
+//! @brief count and image buffers recycled from frame to frame
+//
+//  A 2000x2000 frame needs 16 MB of counts and 12 MB of pixels; taken
+//  fresh every frame they are page-faulted in again each time. The pool
+//  keeps the buffers of finished frames and hands them out again:
+//  counts() returns a vector that goes back to the pool when its last
+//  owner drops it, image() reuses a cv::Mat no one but the pool refers to
+//  any more (frames still shown, queued for writing or encoded are
+//  skipped). At most max_free buffers of each kind are kept idle.
+class FramePool : public std::enable_shared_from_this<FramePool>
+{
+public:
+    typedef std::shared_ptr<std::vector<int>> Counts;
+
+    struct Stats
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+        //! @brief held by the pool, idle or in use
+        size_t bytes = 0;
+        std::string info() const;
+    };
+
+    //! @brief make through std::make_shared: counts() needs a weak_ptr
+    explicit FramePool(const size_t max_free = 4);
+
+    //! @brief n counts, zero; back in the pool once the last copy goes
+    Counts counts(const size_t n);
+    //! @brief rows x cols of type, contents undefined
+    cv::Mat image(const int rows, const int cols, const int type);
+
+    Stats stats() const;
+
+private:
+    void recycle(std::vector<int>* buffer);
+
+    size_t _max_free;
+    mutable std::mutex _lock;
+    std::vector<std::unique_ptr<std::vector<int>>> _counts;
+    std::vector<cv::Mat> _images;
+    Stats _stats;
+};
+} // namespace FRACTAL
+
+#endif // FRACT_FRAMEPOOL_H
@@ -0,0 +1,142 @@
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+#include <opencv2/imgproc.hpp>
+
+#include "framesink.h"
+#include "tools.h"
+#include "trace.h"
+
+#ifdef _WINDOWS
+#define popen _popen
+#define pclose _pclose
+#endif
+
+using namespace std;
+using namespace FRACTAL;
+
+namespace
+{
+bool endsWith(const std::string& s, const std::string& suffix)
+{
+	return s.size() >= suffix.size()
+		&& s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+} // namespace
+
+std::unique_ptr<FrameSink> FRACTAL::FrameSink::open(
+	const std::string& target,
+	const double fps,
+	const cv::Size& size
+)
+{
+	if(!(fps > 0.0))
+		throw std::runtime_error("FrameSink: fps must be positive");
+	if(!target.empty() && target[0] == '|')
+		return std::unique_ptr<FrameSink>(new Y4MSink(target.substr(1), true, fps, size));
+	if(endsWith(target, ".y4m"))
+		return std::unique_ptr<FrameSink>(new Y4MSink(target, false, fps, size));
+	const int fourcc = endsWith(target, ".avi")
+		? cv::VideoWriter::fourcc('M', 'J', 'P', 'G')
+		: cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+	return std::unique_ptr<FrameSink>(new VideoSink(target, fourcc, fps, size));
+}
+
+FRACTAL::VideoSink::VideoSink(
+	const std::string& path,
+	const int fourcc,
+	const double fps,
+	const cv::Size& size
+)
+: _size(size)
+{
+	if(!_writer.open(path, fourcc, fps, size, true) || !_writer.isOpened())
+		throw std::runtime_error("VideoSink: cannot open " + path);
+	cout << "VideoSink::writing " << path << " at " << fps << " fps" << endl;
+}
+
+FRACTAL::VideoSink::~VideoSink()
+{
+	close();
+}
+
+bool FRACTAL::VideoSink::write(const cv::Mat& frame)
+{
+	if(!_writer.isOpened() || frame.size() != _size || frame.type() != CV_8UC3)
+		return false;
+	Trace::Span span("encode");
+	_writer.write(frame);
+	++_frames;
+	return true;
+}
+
+void FRACTAL::VideoSink::close()
+{
+	if(!_writer.isOpened())
+		return;
+	_writer.release();
+	cout << "VideoSink::closed after " << _frames << " frames" << endl;
+}
+
+FRACTAL::Y4MSink::Y4MSink(
+	const std::string& path,
+	const bool pipe,
+	const double fps,
+	const cv::Size& size
+)
+: _pipe(pipe)
+, _size(size)
+{
+	// 4:2:0 halves both axes of the chroma planes
+	if(size.width % 2 != 0 || size.height % 2 != 0)
+		throw std::runtime_error("Y4MSink: frame size must be even");
+	_out = pipe ? popen(path.c_str(), "w") : fopen(path.c_str(), "wb");
+	if(!_out)
+		throw std::runtime_error("Y4MSink: cannot open " + path);
+	// frame rate as a ratio, exact for integer and NTSC-like rates
+	const int den = std::fabs(fps - std::round(fps)) < 1e-9 ? 1 : 1001;
+	const int num = static_cast<int>(std::lround(fps*den));
+	fprintf(
+		_out,
+		"YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C420jpeg\n",
+		size.width,
+		size.height,
+		num,
+		den
+	);
+	cout << "Y4MSink::writing " << (pipe ? "|" : "") << path << " at " << fps << " fps" << endl;
+}
+
+FRACTAL::Y4MSink::~Y4MSink()
+{
+	close();
+}
+
+bool FRACTAL::Y4MSink::write(const cv::Mat& frame)
+{
+	if(!_out || frame.size() != _size || frame.type() != CV_8UC3)
+		return false;
+	Trace::Span span("encode");
+	cv::cvtColor(frame, _yuv, cv::COLOR_BGR2YUV_I420);
+	const size_t bytes = _yuv.total()*_yuv.elemSize();
+	if(fputs("FRAME\n", _out) < 0 || fwrite(_yuv.data, 1, bytes, _out) != bytes)
+	{
+		cout << "Y4MSink::write failed at frame " << _frames << endl;
+		return false;
+	}
+	++_frames;
+	return true;
+}
+
+void FRACTAL::Y4MSink::close()
+{
+	if(!_out)
+		return;
+	if(_pipe)
+		pclose(_out);
+	else
+		fclose(_out);
+	_out = nullptr;
+	cout << "Y4MSink::closed after " << _frames << " frames" << endl;
+}
@@ -0,0 +1,87 @@
+#ifndef FRACT_FRAMESINK_H
+#define FRACT_FRAMESINK_H
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+namespace FRACTAL
+{
+//! @brief frames of a zoom sequence encoded as they come, in order
+//
+//  One pass from render to video, no file per frame: a sink holds one
+//  frame at most, whatever the length of the sequence.
+class FrameSink
+{
+public:
+    virtual ~FrameSink() = default;
+    //! @brief append frame, CV_8UC3 BGR of the size the sink was opened
+    //         with; false if it could not be encoded
+    virtual bool write(const cv::Mat& frame) = 0;
+    //! @brief finish the stream; writes after it fail
+    virtual void close() = 0;
+    size_t frames() const { return _frames; }
+
+    //! @brief sink for target at fps frames per second:
+    //         "|command" pipes YUV4MPEG2 to the stdin of command
+    //         (e.g. "|ffmpeg -i - zoom.mp4"), a .y4m path writes it to
+    //         a file, anything else goes to cv::VideoWriter (MJPG in an
+    //         .avi, mp4v otherwise); throws if it cannot be opened
+    static std::unique_ptr<FrameSink> open(
+        const std::string& target,
+        const double fps,
+        const cv::Size& size
+    );
+
+protected:
+    size_t _frames = 0;
+};
+
+//! @brief cv::VideoWriter behind the FrameSink interface
+class VideoSink : public FrameSink
+{
+public:
+    VideoSink(
+        const std::string& path,
+        const int fourcc,
+        const double fps,
+        const cv::Size& size
+    );
+    ~VideoSink() override;
+    bool write(const cv::Mat& frame) override;
+    void close() override;
+
+private:
+    cv::VideoWriter _writer;
+    cv::Size _size;
+};
+
+//! @brief raw YUV4MPEG2, 4:2:0, to a file or to the stdin of a command;
+//         any encoder that reads y4m takes it without options
+class Y4MSink : public FrameSink
+{
+public:
+    //! @brief pipe: path is a shell command
+    Y4MSink(
+        const std::string& path,
+        const bool pipe,
+        const double fps,
+        const cv::Size& size
+    );
+    ~Y4MSink() override;
+    bool write(const cv::Mat& frame) override;
+    void close() override;
+
+private:
+    FILE* _out = nullptr;
+    bool _pipe;
+    cv::Size _size;
+    //! @brief planar I420 of the last frame, reused
+    cv::Mat _yuv;
+};
+} // namespace FRACTAL
+
+#endif // FRACT_FRAMESINK_H
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+
+#include <opencv2/highgui/highgui.hpp>
+
+#include "imagewriter.h"
+#include "scheduler.h"
+#include "trace.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+namespace
+{
+double msSince(const std::chrono::steady_clock::time_point& start)
+{
+	return std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start
+	).count();
+}
+} // namespace
+
+std::string FRACTAL::ImageWriter::Stats::info() const
+{
+	return cv::format(
+		"ImageWriter::written %zu failed %zu latency mean %.1f ms max %.1f ms encode %.1f ms blocked %.1f ms",
+		written,
+		failed,
+		mean_ms,
+		max_ms,
+		encode_ms,
+		blocked_ms
+	);
+}
+
+FRACTAL::ImageWriter::ImageWriter(const int threads, const size_t capacity)
+: _queue(capacity)
+{
+	const int n = Scheduler::threads(threads);
+	for(int k = 0; k < n; ++k)
+		_threads.emplace_back(&ImageWriter::run, this);
+}
+
+FRACTAL::ImageWriter::~ImageWriter()
+{
+	_queue.close();
+	for(auto& th : _threads)
+		th.join();
+}
+
+void FRACTAL::ImageWriter::write(const std::string& path, cv::Mat image)
+{
+	auto start = std::chrono::steady_clock::now();
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		++_queued;
+	}
+	Job job{path, std::move(image), start};
+	const bool pushed = _queue.push(std::move(job));
+	std::lock_guard<std::mutex> lock(_lock);
+	_stats.blocked_ms += msSince(start);
+	if(!pushed)
+	{
+		--_queued;
+		++_stats.failed;
+		cout << "ImageWriter::closed, not written " << path << endl;
+	}
+}
+
+void FRACTAL::ImageWriter::flush()
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	_done.wait(lock, [this]() { return _queued == 0; });
+}
+
+FRACTAL::ImageWriter::Stats FRACTAL::ImageWriter::stats() const
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _stats;
+}
+
+void FRACTAL::ImageWriter::run()
+{
+	Job job;
+	while(_queue.pop(job))
+	{
+		auto encode_start = std::chrono::steady_clock::now();
+		bool ok = false;
+		// written aside and renamed: a file under its final name is
+		// always whole, so a rerun may skip it
+		const auto dot = job.path.find_last_of('.');
+		const auto part = dot == std::string::npos || job.path.find_first_of("/\\", dot) != std::string::npos
+			? job.path + ".part"
+			: job.path.substr(0, dot) + ".part" + job.path.substr(dot);
+		try
+		{
+			Trace::Span span("encode");
+			ok = cv::imwrite(part, job.image)
+				&& std::rename(part.c_str(), job.path.c_str()) == 0;
+		}
+		catch(const std::exception& e)
+		{
+			cout << "ImageWriter::failed " << job.path << "::" << e.what() << endl;
+		}
+		const double encode_ms = msSince(encode_start);
+		const double latency_ms = msSince(job.queued);
+		job.image.release();
+		if(ok)
+			cout << "written at " << job.path << endl;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			if(ok)
+			{
+				++_stats.written;
+				_total_ms += latency_ms;
+				_stats.mean_ms = _total_ms/_stats.written;
+				_stats.max_ms = std::max(_stats.max_ms, latency_ms);
+				_stats.encode_ms += encode_ms;
+			}
+			else
+				++_stats.failed;
+			--_queued;
+		}
+		_done.notify_all();
+	}
+}
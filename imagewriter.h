@@ -0,0 +1,137 @@
+#ifndef FRACT_IMAGEWRITER_H
+#define FRACT_IMAGEWRITER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace FRACTAL
+{
+//! @brief fifo of at most capacity items: push() blocks while it is full,
+//         pop() while it is empty; after close() pushes are refused and
+//         pop() drains what is left, then returns false
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(const size_t capacity)
+    : _capacity(capacity > 0 ? capacity : 1)
+    {}
+
+    bool push(T&& item)
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        _not_full.wait(lock, [this]() { return _closed || _items.size() < _capacity; });
+        if(_closed)
+            return false;
+        _items.push_back(std::move(item));
+        lock.unlock();
+        _not_empty.notify_one();
+        return true;
+    }
+
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        _not_empty.wait(lock, [this]() { return _closed || !_items.empty(); });
+        if(_items.empty())
+            return false;
+        item = std::move(_items.front());
+        _items.pop_front();
+        lock.unlock();
+        _not_full.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _closed = true;
+        }
+        _not_full.notify_all();
+        _not_empty.notify_all();
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        return _items.size();
+    }
+
+private:
+    size_t _capacity;
+    bool _closed = false;
+    std::deque<T> _items;
+    mutable std::mutex _lock;
+    std::condition_variable _not_full, _not_empty;
+};
+
+//! @brief encodes and writes frames on threads of its own
+//
+//  PNG compression of a large frame costs as much as rendering an easy
+//  one. write() hands the frame to a bounded queue and returns, so the
+//  next frame renders while encoders work on the previous ones; once
+//  capacity frames wait, write() blocks until an encoder takes one, which
+//  bounds the memory held by frames not written yet. Every frame queued
+//  is written before the destructor returns.
+class ImageWriter
+{
+public:
+    struct Stats
+    {
+        size_t written = 0;
+        size_t failed = 0;
+        //! @brief from write() to the file on disk, per frame
+        double mean_ms = 0.0;
+        double max_ms = 0.0;
+        //! @brief encoding only, summed over frames
+        double encode_ms = 0.0;
+        //! @brief write() blocked on a full queue, summed over frames
+        double blocked_ms = 0.0;
+        std::string info() const;
+    };
+
+    //! @brief threads encoders, 0 = all cores; capacity frames queued
+    explicit ImageWriter(const int threads = 2, const size_t capacity = 4);
+    //! @brief writes every frame queued, then joins the encoders
+    ~ImageWriter();
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator=(const ImageWriter&) = delete;
+
+    //! @brief queue image for path; the pixels are shared, not copied, so
+    //         the caller must not change them afterwards
+    void write(const std::string& path, cv::Mat image);
+
+    //! @brief block until every frame queued so far is on disk
+    void flush();
+
+    Stats stats() const;
+
+private:
+    struct Job
+    {
+        std::string path;
+        cv::Mat image;
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    void run();
+
+    BoundedQueue<Job> _queue;
+    mutable std::mutex _lock;
+    std::condition_variable _done;
+    size_t _queued = 0;
+    Stats _stats;
+    double _total_ms = 0.0;
+    std::vector<std::thread> _threads;
+};
+} // namespace FRACTAL
+
+#endif // FRACT_IMAGEWRITER_H
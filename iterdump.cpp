@@ -0,0 +1,230 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#ifndef _WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "compactcounts.h"
+#include "iterdump.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+namespace
+{
+const int32_t DUMP_MAGIC = 0x52544946; // "FITR"
+const int32_t DUMP_VERSION = 1;
+//! @brief orbit steps past the escape before log|z| is taken: |z| grows
+//         far beyond 2 and the bands of the small bailout fade
+const int SMOOTH_STEPS = 4;
+} // namespace
+
+void FRACTAL::IterDump::save(
+	const std::string& path,
+	const CS<int>& scr,
+	const CS<double>& fract,
+	const int iter_max,
+	const int formula,
+	const std::vector<int>& counts,
+	const std::vector<float>& smooth,
+	const bool compact
+)
+{
+	const size_t n = static_cast<size_t>(scr.width())*scr.height();
+	if(counts.size() != n || (!smooth.empty() && smooth.size() != n))
+		throw std::runtime_error("IterDump: buffer size does not match the frame");
+	const bool narrow = compact && CompactCounts::fits(iter_max);
+	Header header{
+		DUMP_MAGIC,
+		DUMP_VERSION,
+		scr.width(),
+		scr.height(),
+		iter_max,
+		formula,
+		(smooth.empty() ? 0 : SMOOTH) | (narrow ? COMPACT : 0),
+		0,
+		fract.x_min(),
+		fract.x_max(),
+		fract.y_min(),
+		fract.y_max()
+	};
+	static_assert(sizeof(Header) == 64, "IterDump header is 64 bytes");
+	static_assert(sizeof(int) == sizeof(int32_t), "counts are dumped as they are");
+	const auto tmp = path + ".tmp";
+	{
+		std::ofstream f(tmp, std::ios::binary);
+		f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if(narrow)
+		{
+			CompactCounts compact_counts(counts, scr.width(), scr.height(), iter_max);
+			const size_t mask_bytes = (n + 63)/64*sizeof(uint64_t);
+			const std::vector<char> pad(countsBytes(n, true) - mask_bytes - n*sizeof(uint16_t), 0);
+			f.write(reinterpret_cast<const char*>(compact_counts.counts()), n*sizeof(uint16_t));
+			f.write(pad.data(), pad.size());
+			f.write(reinterpret_cast<const char*>(compact_counts.interior()), mask_bytes);
+		}
+		else
+			f.write(reinterpret_cast<const char*>(counts.data()), n*sizeof(int32_t));
+		if(!smooth.empty())
+			f.write(reinterpret_cast<const char*>(smooth.data()), n*sizeof(float));
+		if(!f)
+			throw std::runtime_error("IterDump: cannot write " + tmp);
+	}
+	if(std::rename(tmp.c_str(), path.c_str()) != 0)
+		throw std::runtime_error("IterDump: cannot rename " + tmp);
+	cout << "IterDump::written " << path << endl;
+}
+
+std::vector<float> FRACTAL::IterDump::smoothCounts(
+	const CS<int>& scr,
+	const CS<double>& fract,
+	const int iter_max,
+	const std::vector<int>& counts
+)
+{
+	const int width = scr.width(), height = scr.height();
+	const double dx = fract.width()/width, dy = fract.height()/height;
+	std::vector<float> smooth(counts.size(), static_cast<float>(iter_max));
+	cv::parallel_for_(
+		cv::Range(0, height),
+		[&](const cv::Range& rows) -> void
+		{
+			for(int y = rows.start; y < rows.end; ++y)
+			{
+				const double ci = fract.y_min() + y*dy;
+				for(int x = 0; x < width; ++x)
+				{
+					const size_t k = static_cast<size_t>(y)*width + x;
+					const int n = counts[k];
+					if(n >= iter_max)
+						continue;
+					const double cr = fract.x_min() + x*dx;
+					double zr = 0.0, zi = 0.0;
+					for(int i = 0; i < n + SMOOTH_STEPS; ++i)
+					{
+						const double t = zr*zr - zi*zi + cr;
+						zi = 2.0*zr*zi + ci;
+						zr = t;
+					}
+					const double r2 = zr*zr + zi*zi;
+					// log2|z| = log2(r2)/2; an orbit that left double range
+					// keeps its integer count
+					if(!(r2 > 4.0) || !std::isfinite(r2))
+					{
+						smooth[k] = static_cast<float>(n);
+						continue;
+					}
+					const double nu = n + SMOOTH_STEPS + 1 - std::log2(0.5*std::log2(r2));
+					smooth[k] = static_cast<float>(std::min(std::max(nu, 0.0), double(iter_max)));
+				}
+			}
+		}
+	);
+	return smooth;
+}
+
+FRACTAL::IterDump::IterDump(const std::string& path)
+{
+#ifndef _WINDOWS
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if(fd < 0)
+		throw std::runtime_error("IterDump: cannot open " + path);
+	struct stat st;
+	if(::fstat(fd, &st) != 0)
+	{
+		::close(fd);
+		throw std::runtime_error("IterDump: cannot stat " + path);
+	}
+	_bytes = static_cast<size_t>(st.st_size);
+	void* map = _bytes >= sizeof(Header)
+		? ::mmap(nullptr, _bytes, PROT_READ, MAP_PRIVATE, fd, 0)
+		: MAP_FAILED;
+	::close(fd);
+	if(map == MAP_FAILED)
+		throw std::runtime_error("IterDump: cannot map " + path);
+	_data = static_cast<const uint8_t*>(map);
+#else
+	std::ifstream f(path, std::ios::binary | std::ios::ate);
+	if(!f)
+		throw std::runtime_error("IterDump: cannot open " + path);
+	_bytes = static_cast<size_t>(f.tellg());
+	_buffer.resize(_bytes);
+	f.seekg(0);
+	f.read(reinterpret_cast<char*>(_buffer.data()), _bytes);
+	_data = _buffer.data();
+	if(_bytes < sizeof(Header))
+		throw std::runtime_error("IterDump: truncated " + path);
+#endif
+	_header = reinterpret_cast<const Header*>(_data);
+	const size_t n = static_cast<size_t>(std::max(_header->width, 0))*std::max(_header->height, 0);
+	const size_t expected = sizeof(Header) + countsBytes(n, _header->flags & COMPACT)
+		+ ((_header->flags & SMOOTH) ? n*sizeof(float) : 0);
+	if(_header->magic != DUMP_MAGIC || _header->version != DUMP_VERSION || _bytes != expected)
+	{
+#ifndef _WINDOWS
+		::munmap(const_cast<uint8_t*>(_data), _bytes);
+#endif
+		throw std::runtime_error("IterDump: not a dump or truncated " + path);
+	}
+}
+
+FRACTAL::IterDump::~IterDump()
+{
+#ifndef _WINDOWS
+	::munmap(const_cast<uint8_t*>(_data), _bytes);
+#endif
+}
+
+CS<double> FRACTAL::IterDump::window() const
+{
+	return CS<double>(_header->x_min, _header->x_max, _header->y_min, _header->y_max);
+}
+
+size_t FRACTAL::IterDump::countsBytes(const size_t n, const bool compact)
+{
+	if(!compact)
+		return n*sizeof(int32_t);
+	// the mask starts on a word boundary
+	return (n*sizeof(uint16_t) + 7)/8*8 + (n + 63)/64*sizeof(uint64_t);
+}
+
+const int32_t* FRACTAL::IterDump::counts() const
+{
+	if(_header->flags & COMPACT)
+		return nullptr;
+	return reinterpret_cast<const int32_t*>(_data + sizeof(Header));
+}
+
+const uint16_t* FRACTAL::IterDump::counts16() const
+{
+	if(!(_header->flags & COMPACT))
+		return nullptr;
+	return reinterpret_cast<const uint16_t*>(_data + sizeof(Header));
+}
+
+const uint64_t* FRACTAL::IterDump::interior() const
+{
+	if(!(_header->flags & COMPACT))
+		return nullptr;
+	const size_t n = static_cast<size_t>(width())*height();
+	return reinterpret_cast<const uint64_t*>(
+		_data + sizeof(Header) + (n*sizeof(uint16_t) + 7)/8*8
+	);
+}
+
+const float* FRACTAL::IterDump::smooth() const
+{
+	if(!(_header->flags & SMOOTH))
+		return nullptr;
+	const size_t n = static_cast<size_t>(width())*height();
+	return reinterpret_cast<const float*>(
+		_data + sizeof(Header) + countsBytes(n, _header->flags & COMPACT)
+	);
+}
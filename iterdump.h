@@ -0,0 +1,100 @@
+#ifndef FRACT_ITERDUMP_H
+#define FRACT_ITERDUMP_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "fract.h"
+
+namespace FRACTAL
+{
+//! @brief escape counts of a frame on disk, to re-color without iterating
+//
+//  File (.fiter, native endianness): a 64-byte header, magic "FITR",
+//  version, width, height, iter_max, formula id, flags, then the window
+//  x_min, x_max, y_min, y_max as doubles; width*height int32 counts, row
+//  by row, or with COMPACT width*height uint16 counts padded to 8 bytes
+//  and the interior mask (CompactCounts); with SMOOTH, width*height float
+//  fractional counts after them. A dump is opened by mapping the file:
+//  counts(), counts16(), interior() and smooth() point into the mapping,
+//  nothing is read or copied up front.
+class IterDump
+{
+public:
+    enum Flags
+    {
+        SMOOTH = 1,
+        COMPACT = 2
+    };
+
+    //! @brief write counts of the window fract, in 16 bits if compact
+    //         and iter_max fits, and smooth if not empty; written aside
+    //         and renamed, throws if it cannot be
+    static void save(
+        const std::string& path,
+        const CS<int>& scr,
+        const CS<double>& fract,
+        const int iter_max,
+        const int formula,
+        const std::vector<int>& counts,
+        const std::vector<float>& smooth = std::vector<float>(),
+        const bool compact = false
+    );
+
+    //! @brief fractional counts n + 1 - log2(log2|z_n|) of the escaped
+    //         pixels of z*z + c, from a few more iterations of their
+    //         orbits in double; iter_max for the others. Costs the
+    //         exterior only, the interior is not iterated again
+    static std::vector<float> smoothCounts(
+        const CS<int>& scr,
+        const CS<double>& fract,
+        const int iter_max,
+        const std::vector<int>& counts
+    );
+
+    //! @brief map path; throws on a file that is not a dump
+    explicit IterDump(const std::string& path);
+    ~IterDump();
+    IterDump(const IterDump&) = delete;
+    IterDump& operator=(const IterDump&) = delete;
+
+    int width() const { return _header->width; }
+    int height() const { return _header->height; }
+    int iterMax() const { return _header->iter_max; }
+    int formula() const { return _header->formula; }
+    CS<double> window() const;
+    //! @brief nullptr in a COMPACT dump, counts16() there
+    const int32_t* counts() const;
+    const uint16_t* counts16() const;
+    //! @brief interior mask of a COMPACT dump, see CompactCounts
+    const uint64_t* interior() const;
+    //! @brief nullptr if the dump has no smooth counts
+    const float* smooth() const;
+
+private:
+    //! @brief bytes of the counts section, mask included
+    static size_t countsBytes(const size_t n, const bool compact);
+
+    struct Header
+    {
+        int32_t magic;
+        int32_t version;
+        int32_t width, height;
+        int32_t iter_max;
+        int32_t formula;
+        int32_t flags;
+        int32_t reserved;
+        double x_min, x_max, y_min, y_max;
+    };
+
+    const Header* _header = nullptr;
+    const uint8_t* _data = nullptr;
+    size_t _bytes = 0;
+#ifdef _WINDOWS
+    std::vector<uint8_t> _buffer;
+#endif
+};
+} // namespace FRACTAL
+
+#endif // FRACT_ITERDUMP_H
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+#include "iterstate.h"
+#include "kernels.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+bool FRACTAL::IterState::matches(
+	const CS<int> &scr,
+	const CS<double> &fract_
+) const
+{
+	return width == scr.width() && height == scr.height()
+		&& fract.x_min() == fract_.x_min() && fract.x_max() == fract_.x_max()
+		&& fract.y_min() == fract_.y_min() && fract.y_max() == fract_.y_max();
+}
+
+void FRACTAL::IterState::reset(
+	const CS<int> &scr,
+	const CS<double> &fract_
+)
+{
+	width = scr.width();
+	height = scr.height();
+	fract = fract_;
+	iter = 0;
+	const size_t size = static_cast<size_t>(width)*height;
+	zr.assign(size, 0.0);
+	zi.assign(size, 0.0);
+	count.assign(size, 0);
+	flags.assign(size, UNKNOWN);
+}
+
+void FRACTAL::IterState::clear()
+{
+	width = 0;
+	height = 0;
+	iter = 0;
+	zr.clear();
+	zi.clear();
+	count.clear();
+	flags.clear();
+}
+
+void FRACTAL::IterState::evaluate(
+	const int* xs,
+	const int* ys,
+	const int n,
+	const double* cr,
+	const double* ci,
+	const int iter_max,
+	const double tol,
+	int* out
+)
+{
+	thread_local std::vector<int> ks, part;
+	thread_local std::vector<double> pr, pi, zs_r, zs_i;
+	// running pixels go on from iter, the unknown ones from 0; a pixel
+	// evaluated twice in a render is already at iter_max the second time
+	for(const auto from : {RUNNING, UNKNOWN})
+	{
+		ks.clear();
+		for(int k = 0; k < n; ++k)
+		{
+			const int p = ys[k]*width + xs[k];
+			const auto flag = flags[p];
+			if(flag == from && (flag == UNKNOWN || count[p] == iter))
+				ks.push_back(k);
+			else if(from == UNKNOWN)
+				continue;
+			else if(flag == ESCAPED)
+				out[k] = count[p];
+			else if(flag != UNKNOWN)
+				out[k] = iter_max;
+		}
+		const int m = static_cast<int>(ks.size());
+		if(m == 0)
+			continue;
+		pr.resize(m);
+		pi.resize(m);
+		zs_r.resize(m);
+		zs_i.resize(m);
+		part.resize(m);
+		for(int j = 0; j < m; ++j)
+		{
+			const int p = ys[ks[j]]*width + xs[ks[j]];
+			pr[j] = cr[ks[j]];
+			pi[j] = ci[ks[j]];
+			zs_r[j] = zr[p];
+			zs_i[j] = zi[p];
+		}
+		kernels::mandelbrotResume(
+			pr.data(),
+			pi.data(),
+			m,
+			from == RUNNING ? iter : 0,
+			iter_max,
+			zs_r.data(),
+			zs_i.data(),
+			part.data(),
+			tol
+		);
+		for(int j = 0; j < m; ++j)
+		{
+			const int p = ys[ks[j]]*width + xs[ks[j]];
+			out[ks[j]] = part[j];
+			count[p] = part[j];
+			if(part[j] < iter_max)
+				flags[p] = ESCAPED;
+			else if(std::isnan(zs_r[j]))
+				flags[p] = INTERIOR;
+			else
+			{
+				flags[p] = RUNNING;
+				zr[p] = zs_r[j];
+				zi[p] = zs_i[j];
+			}
+		}
+		(from == RUNNING ? resumed : restarted) += m;
+	}
+}
+
+void FRACTAL::IterState::finish(
+	const std::vector<int> &colors,
+	const int iter_max
+)
+{
+	for(size_t p = 0; p < flags.size(); ++p)
+	{
+		// filled by the render, or left behind at the old iter by it
+		if(flags[p] == UNKNOWN || (flags[p] == RUNNING && count[p] < iter_max))
+		{
+			count[p] = colors[p];
+			flags[p] = colors[p] < iter_max ? ESCAPED : UNKNOWN;
+		}
+	}
+	if(iter > 0)
+	{
+		cout << cv::format(
+			"IterState::%d -> %d iters, resumed %.1f%%, restarted %.1f%%",
+			iter,
+			iter_max,
+			100.0*resumed/std::max<size_t>(flags.size(), 1),
+			100.0*restarted/std::max<size_t>(flags.size(), 1)
+		) << endl;
+	}
+	iter = iter_max;
+	resumed = 0;
+	restarted = 0;
+}
+
+void FRACTAL::IterState::counts(
+	const int iter_max,
+	std::vector<int> &colors
+) const
+{
+	colors.resize(flags.size());
+	for(size_t p = 0; p < flags.size(); ++p)
+		colors[p] = flags[p] == INTERIOR ? iter_max : std::min(count[p], iter_max);
+}
@@ -0,0 +1,72 @@
+#ifndef FRACT_ITERSTATE_H
+#define FRACT_ITERSTATE_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "fract.h"
+
+namespace FRACTAL
+{
+//! @brief where the orbit of every pixel of a frame stopped
+//
+//  Raising iter_max on the same window only has to continue the pixels
+//  that had not escaped yet, from the z they stopped at. The simd kernel
+//  path leaves z, the count and a flag of every pixel it evaluates here.
+//  Pixels filled by subdivision or taken from a reprojection have no z:
+//  the escaped ones are settled, the others start again from 0 if the
+//  render to the higher iter_max evaluates them at all.
+struct IterState
+{
+    enum Flag : uint8_t
+    {
+        //! @brief count reached iter, no z kept
+        UNKNOWN = 0,
+        ESCAPED = 1,
+        //! @brief proven never to escape (cardioid/bulb, cycle)
+        INTERIOR = 2,
+        //! @brief not escaped after iter iterations, z = z_iter
+        RUNNING = 3
+    };
+    std::vector<double> zr, zi;
+    std::vector<int> count;
+    std::vector<uint8_t> flags;
+    //! @brief iterations done by every RUNNING pixel
+    int iter = 0;
+    //! @brief the window and frame size of the state
+    CS<double> fract{0.0, 0.0, 0.0, 0.0};
+    int width = 0, height = 0;
+    //! @brief orbits continued / started from 0 since the last finish()
+    std::atomic<size_t> resumed{0}, restarted{0};
+
+    bool matches(const CS<int> &scr, const CS<double> &fract) const;
+    //! @brief forget every pixel, the state is now for fract
+    void reset(const CS<int> &scr, const CS<double> &fract);
+    //! @brief forget every pixel and the window, e.g. after a render was
+    //         cancelled half way
+    void clear();
+
+    //! @brief counts of pixels (xs[k], ys[k]) at iter_max >= iter, c =
+    //         (cr[k], ci[k]): the settled ones as they are, the running
+    //         ones continued from z_iter, the unknown ones from 0
+    void evaluate(
+        const int* xs,
+        const int* ys,
+        const int n,
+        const double* cr,
+        const double* ci,
+        const int iter_max,
+        const double tol,
+        int* out
+    );
+    //! @brief after a render to iter_max that went through evaluate():
+    //         pixels it filled without evaluating keep their colors
+    void finish(const std::vector<int> &colors, const int iter_max);
+
+    //! @brief counts at iter_max <= iter
+    void counts(const int iter_max, std::vector<int> &colors) const;
+};
+} // namespace FRACTAL
+
+#endif // FRACT_ITERSTATE_H
@@ -0,0 +1,963 @@
+#if defined(__GNUC__) && !defined(__clang__)
+// avx512f implies fma and gcc would fuse mul+add, see the note below
+#pragma GCC optimize("fp-contract=off")
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "kernels.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FRACT_KERNELS_X86 1
+#include <immintrin.h>
+#define FRACT_TARGET(isa) __attribute__((target(isa)))
+#else
+#define FRACT_KERNELS_X86 0
+#endif
+
+using namespace FRACTAL;
+
+namespace
+{
+std::atomic<int> activeIsa_(-1);
+std::atomic<bool> interiorChecks_(true);
+
+// every kernel below follows Fract::escape: a lane stops counting at the
+// first iteration with |z| >= 2, the mask is sticky so an escaped lane
+// that keeps being iterated (and may overflow to inf/nan) never counts again.
+// No fma on purpose: all isas have to round exactly like the scalar loop.
+//
+// With tol > 0 the lanes also stop at iter_max early when c lies in the
+// main cardioid or the period-2 bulb, or when z comes back within tol of
+// the point saved at the last power-of-two iteration (Brent). All lanes
+// iterate in lockstep, so the checkpoints are shared by the group. The
+// distance is only tested every 4th iteration: a cycle of period p is
+// still caught, at most 4p iterations later, for a quarter of the cost.
+
+inline bool inMainComponents(const double x, const double y)
+{
+	const double xq = x - 0.25, y2 = y*y;
+	const double q = xq*xq + y2;
+	const double xb = x + 1.0;
+	return q*(q + xq) < 0.25*y2 || xb*xb + y2 < 0.0625;
+}
+
+// A kernel can also start from z after iter_from iterations (zr_io, zi_io)
+// and leave there where every orbit stopped, PROVEN in zr for the lanes the
+// interior checks settled. The Brent checkpoint then starts at the resumed
+// z, the next one at the first power of two past iter_from.
+const double PROVEN = std::numeric_limits<double>::quiet_NaN();
+
+inline int firstCheck(const int iter_from)
+{
+	int check = 1;
+	while(check <= iter_from && check < (1 << 30))
+		check <<= 1;
+	return check;
+}
+
+void mandelbrotRowScalar(
+	const double* cx,
+	const double* cy,
+	const int cy_step,
+	const int n,
+	const int iter_from,
+	const int iter_max,
+	double* zr_io,
+	double* zi_io,
+	int* out,
+	const double tol
+)
+{
+	const int check_from = firstCheck(iter_from);
+	for(int k = 0; k < n; ++k)
+	{
+		const double cr = cx[k], ci = cy[k*cy_step];
+		if(tol > 0.0 && inMainComponents(cr, ci))
+		{
+			out[k] = iter_max;
+			if(zr_io)
+				zr_io[k] = PROVEN;
+			continue;
+		}
+		double zr = 0.0, zi = 0.0;
+		if(iter_from > 0)
+		{
+			zr = zr_io[k];
+			zi = zi_io[k];
+		}
+		double sr = zr, si = zi;
+		int check = check_from;
+		int iter = iter_from;
+		bool proven = false;
+		while(iter < iter_max)
+		{
+			const double zr2 = zr*zr, zi2 = zi*zi;
+			if(zr2 + zi2 >= 4.0)
+				break;
+			zi = (zr + zr)*zi + ci;
+			zr = zr2 - zi2 + cr;
+			++iter;
+			if(tol > 0.0 && (iter & 3) == 0
+				&& std::fabs(zr - sr) < tol && std::fabs(zi - si) < tol)
+			{
+				iter = iter_max;
+				proven = true;
+				break;
+			}
+			if(tol > 0.0 && iter == check)
+			{
+				sr = zr;
+				si = zi;
+				check <<= 1;
+			}
+		}
+		out[k] = iter;
+		if(zr_io)
+		{
+			zr_io[k] = proven ? PROVEN : zr;
+			zi_io[k] = zi;
+		}
+	}
+}
+
+#if FRACT_KERNELS_X86
+//! @brief copy a partial lane group, padding lanes that escape at once
+inline const double* laneGroup(
+	const double* cx,
+	const int k,
+	const int n,
+	const int lanes,
+	double* pad
+)
+{
+	if(k + lanes <= n)
+		return cx + k;
+	for(int j = 0; j < lanes; ++j)
+		pad[j] = k + j < n ? cx[k + j] : 4.0;
+	return pad;
+}
+
+inline void storeCounts(
+	const double* counts,
+	const int k,
+	const int n,
+	const int lanes,
+	int* out
+)
+{
+	const int m = std::min(lanes, n - k);
+	for(int j = 0; j < m; ++j)
+		out[k + j] = static_cast<int>(counts[j]);
+}
+
+inline void storeLanes(
+	const double* values,
+	const int k,
+	const int n,
+	const int lanes,
+	double* out
+)
+{
+	const int m = std::min(lanes, n - k);
+	for(int j = 0; j < m; ++j)
+		out[k + j] = values[j];
+}
+
+FRACT_TARGET("sse2")
+inline __m128d blendSSE2(const __m128d a, const __m128d b, const __m128d mask)
+{
+	return _mm_or_pd(_mm_and_pd(mask, b), _mm_andnot_pd(mask, a));
+}
+
+FRACT_TARGET("sse2")
+void mandelbrotRowSSE2(
+	const double* cx,
+	const double* cy,
+	const int cy_step,
+	const int n,
+	const int iter_from,
+	const int iter_max,
+	double* zr_io,
+	double* zi_io,
+	int* out,
+	const double tol
+)
+{
+	const __m128d four = _mm_set1_pd(4.0);
+	const __m128d one = _mm_set1_pd(1.0);
+	const __m128d itmax = _mm_set1_pd(iter_max);
+	const __m128d tolv = _mm_set1_pd(tol);
+	const __m128d sign = _mm_set1_pd(-0.0);
+	const int check_from = firstCheck(iter_from);
+	alignas(16) double pad[2], pad_y[2], counts[2];
+	alignas(16) double pad_zr[2], pad_zi[2], zs[2];
+	for(int k = 0; k < n; k += 2)
+	{
+		const __m128d cr = _mm_loadu_pd(laneGroup(cx, k, n, 2, pad));
+		const __m128d ci = cy_step
+			? _mm_loadu_pd(laneGroup(cy, k, n, 2, pad_y))
+			: _mm_set1_pd(*cy);
+		const __m128d y2 = _mm_mul_pd(ci, ci);
+		__m128d zr = _mm_setzero_pd(), zi = _mm_setzero_pd();
+		if(iter_from > 0)
+		{
+			zr = _mm_loadu_pd(laneGroup(zr_io, k, n, 2, pad_zr));
+			zi = _mm_loadu_pd(laneGroup(zi_io, k, n, 2, pad_zi));
+		}
+		__m128d sr = zr, si = zi;
+		__m128d count = _mm_set1_pd(iter_from);
+		__m128d active = _mm_cmpeq_pd(zr, zr);
+		__m128d proven = _mm_setzero_pd();
+		if(tol > 0.0)
+		{
+			const __m128d xq = _mm_sub_pd(cr, _mm_set1_pd(0.25));
+			const __m128d q = _mm_add_pd(_mm_mul_pd(xq, xq), y2);
+			const __m128d xb = _mm_add_pd(cr, one);
+			const __m128d inside = _mm_or_pd(
+				_mm_cmplt_pd(_mm_mul_pd(q, _mm_add_pd(q, xq)), _mm_mul_pd(_mm_set1_pd(0.25), y2)),
+				_mm_cmplt_pd(_mm_add_pd(_mm_mul_pd(xb, xb), y2), _mm_set1_pd(0.0625))
+			);
+			count = blendSSE2(count, itmax, inside);
+			active = _mm_andnot_pd(inside, active);
+			proven = inside;
+		}
+		int check = check_from;
+		for(int iter = iter_from; iter < iter_max && _mm_movemask_pd(active) != 0; ++iter)
+		{
+			const __m128d zr2 = _mm_mul_pd(zr, zr);
+			const __m128d zi2 = _mm_mul_pd(zi, zi);
+			active = _mm_and_pd(active, _mm_cmplt_pd(_mm_add_pd(zr2, zi2), four));
+			if(_mm_movemask_pd(active) == 0)
+				break;
+			count = _mm_add_pd(count, _mm_and_pd(active, one));
+			zi = _mm_add_pd(_mm_mul_pd(_mm_add_pd(zr, zr), zi), ci);
+			zr = _mm_add_pd(_mm_sub_pd(zr2, zi2), cr);
+			if(tol > 0.0 && ((iter + 1) & 3) == 0)
+			{
+				const __m128d periodic = _mm_and_pd(active, _mm_and_pd(
+					_mm_cmplt_pd(_mm_andnot_pd(sign, _mm_sub_pd(zr, sr)), tolv),
+					_mm_cmplt_pd(_mm_andnot_pd(sign, _mm_sub_pd(zi, si)), tolv)
+				));
+				count = blendSSE2(count, itmax, periodic);
+				active = _mm_andnot_pd(periodic, active);
+				proven = _mm_or_pd(proven, periodic);
+			}
+			if(tol > 0.0 && iter + 1 == check)
+			{
+				sr = zr;
+				si = zi;
+				check <<= 1;
+			}
+		}
+		_mm_store_pd(counts, count);
+		storeCounts(counts, k, n, 2, out);
+		if(zr_io)
+		{
+			_mm_store_pd(zs, blendSSE2(zr, _mm_set1_pd(PROVEN), proven));
+			storeLanes(zs, k, n, 2, zr_io);
+			_mm_store_pd(zs, zi);
+			storeLanes(zs, k, n, 2, zi_io);
+		}
+	}
+}
+
+FRACT_TARGET("avx2")
+void mandelbrotRowAVX2(
+	const double* cx,
+	const double* cy,
+	const int cy_step,
+	const int n,
+	const int iter_from,
+	const int iter_max,
+	double* zr_io,
+	double* zi_io,
+	int* out,
+	const double tol
+)
+{
+	const __m256d four = _mm256_set1_pd(4.0);
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d itmax = _mm256_set1_pd(iter_max);
+	const __m256d tolv = _mm256_set1_pd(tol);
+	const __m256d sign = _mm256_set1_pd(-0.0);
+	const int check_from = firstCheck(iter_from);
+	alignas(32) double pad[4], pad_y[4], counts[4];
+	alignas(32) double pad_zr[4], pad_zi[4], zs[4];
+	for(int k = 0; k < n; k += 4)
+	{
+		const __m256d cr = _mm256_loadu_pd(laneGroup(cx, k, n, 4, pad));
+		const __m256d ci = cy_step
+			? _mm256_loadu_pd(laneGroup(cy, k, n, 4, pad_y))
+			: _mm256_set1_pd(*cy);
+		const __m256d y2 = _mm256_mul_pd(ci, ci);
+		__m256d zr = _mm256_setzero_pd(), zi = _mm256_setzero_pd();
+		if(iter_from > 0)
+		{
+			zr = _mm256_loadu_pd(laneGroup(zr_io, k, n, 4, pad_zr));
+			zi = _mm256_loadu_pd(laneGroup(zi_io, k, n, 4, pad_zi));
+		}
+		__m256d sr = zr, si = zi;
+		__m256d count = _mm256_set1_pd(iter_from);
+		__m256d active = _mm256_cmp_pd(zr, zr, _CMP_EQ_OQ);
+		__m256d proven = _mm256_setzero_pd();
+		if(tol > 0.0)
+		{
+			const __m256d xq = _mm256_sub_pd(cr, _mm256_set1_pd(0.25));
+			const __m256d q = _mm256_add_pd(_mm256_mul_pd(xq, xq), y2);
+			const __m256d xb = _mm256_add_pd(cr, one);
+			const __m256d inside = _mm256_or_pd(
+				_mm256_cmp_pd(
+					_mm256_mul_pd(q, _mm256_add_pd(q, xq)),
+					_mm256_mul_pd(_mm256_set1_pd(0.25), y2),
+					_CMP_LT_OQ
+				),
+				_mm256_cmp_pd(
+					_mm256_add_pd(_mm256_mul_pd(xb, xb), y2),
+					_mm256_set1_pd(0.0625),
+					_CMP_LT_OQ
+				)
+			);
+			count = _mm256_blendv_pd(count, itmax, inside);
+			active = _mm256_andnot_pd(inside, active);
+			proven = inside;
+		}
+		int check = check_from;
+		for(int iter = iter_from; iter < iter_max && _mm256_movemask_pd(active) != 0; ++iter)
+		{
+			const __m256d zr2 = _mm256_mul_pd(zr, zr);
+			const __m256d zi2 = _mm256_mul_pd(zi, zi);
+			active = _mm256_and_pd(
+				active,
+				_mm256_cmp_pd(_mm256_add_pd(zr2, zi2), four, _CMP_LT_OQ)
+			);
+			if(_mm256_movemask_pd(active) == 0)
+				break;
+			count = _mm256_add_pd(count, _mm256_and_pd(active, one));
+			zi = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(zr, zr), zi), ci);
+			zr = _mm256_add_pd(_mm256_sub_pd(zr2, zi2), cr);
+			if(tol > 0.0 && ((iter + 1) & 3) == 0)
+			{
+				const __m256d periodic = _mm256_and_pd(active, _mm256_and_pd(
+					_mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(zr, sr)), tolv, _CMP_LT_OQ),
+					_mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(zi, si)), tolv, _CMP_LT_OQ)
+				));
+				count = _mm256_blendv_pd(count, itmax, periodic);
+				active = _mm256_andnot_pd(periodic, active);
+				proven = _mm256_or_pd(proven, periodic);
+			}
+			if(tol > 0.0 && iter + 1 == check)
+			{
+				sr = zr;
+				si = zi;
+				check <<= 1;
+			}
+		}
+		_mm256_store_pd(counts, count);
+		storeCounts(counts, k, n, 4, out);
+		if(zr_io)
+		{
+			_mm256_store_pd(zs, _mm256_blendv_pd(zr, _mm256_set1_pd(PROVEN), proven));
+			storeLanes(zs, k, n, 4, zr_io);
+			_mm256_store_pd(zs, zi);
+			storeLanes(zs, k, n, 4, zi_io);
+		}
+	}
+}
+
+FRACT_TARGET("avx512f")
+void mandelbrotRowAVX512(
+	const double* cx,
+	const double* cy,
+	const int cy_step,
+	const int n,
+	const int iter_from,
+	const int iter_max,
+	double* zr_io,
+	double* zi_io,
+	int* out,
+	const double tol
+)
+{
+	const __m512d four = _mm512_set1_pd(4.0);
+	const __m512d one = _mm512_set1_pd(1.0);
+	const __m512d itmax = _mm512_set1_pd(iter_max);
+	const __m512d tolv = _mm512_set1_pd(tol);
+	const int check_from = firstCheck(iter_from);
+	alignas(64) double pad[8], pad_y[8], counts[8];
+	alignas(64) double pad_zr[8], pad_zi[8], zs[8];
+	for(int k = 0; k < n; k += 8)
+	{
+		const __m512d cr = _mm512_loadu_pd(laneGroup(cx, k, n, 8, pad));
+		const __m512d ci = cy_step
+			? _mm512_loadu_pd(laneGroup(cy, k, n, 8, pad_y))
+			: _mm512_set1_pd(*cy);
+		const __m512d y2 = _mm512_mul_pd(ci, ci);
+		__m512d zr = _mm512_setzero_pd(), zi = _mm512_setzero_pd();
+		if(iter_from > 0)
+		{
+			zr = _mm512_loadu_pd(laneGroup(zr_io, k, n, 8, pad_zr));
+			zi = _mm512_loadu_pd(laneGroup(zi_io, k, n, 8, pad_zi));
+		}
+		__m512d sr = zr, si = zi;
+		__m512d count = _mm512_set1_pd(iter_from);
+		__mmask8 active = 0xFF;
+		__mmask8 proven = 0;
+		if(tol > 0.0)
+		{
+			const __m512d xq = _mm512_sub_pd(cr, _mm512_set1_pd(0.25));
+			const __m512d q = _mm512_add_pd(_mm512_mul_pd(xq, xq), y2);
+			const __m512d xb = _mm512_add_pd(cr, one);
+			const __mmask8 inside = _mm512_cmp_pd_mask(
+					_mm512_mul_pd(q, _mm512_add_pd(q, xq)),
+					_mm512_mul_pd(_mm512_set1_pd(0.25), y2),
+					_CMP_LT_OQ
+				) | _mm512_cmp_pd_mask(
+					_mm512_add_pd(_mm512_mul_pd(xb, xb), y2),
+					_mm512_set1_pd(0.0625),
+					_CMP_LT_OQ
+				);
+			count = _mm512_mask_blend_pd(inside, count, itmax);
+			active &= ~inside;
+			proven = inside;
+		}
+		int check = check_from;
+		for(int iter = iter_from; iter < iter_max && active != 0; ++iter)
+		{
+			const __m512d zr2 = _mm512_mul_pd(zr, zr);
+			const __m512d zi2 = _mm512_mul_pd(zi, zi);
+			active &= _mm512_cmp_pd_mask(_mm512_add_pd(zr2, zi2), four, _CMP_LT_OQ);
+			if(active == 0)
+				break;
+			count = _mm512_mask_add_pd(count, active, count, one);
+			zi = _mm512_add_pd(_mm512_mul_pd(_mm512_add_pd(zr, zr), zi), ci);
+			zr = _mm512_add_pd(_mm512_sub_pd(zr2, zi2), cr);
+			if(tol > 0.0 && ((iter + 1) & 3) == 0)
+			{
+				const __mmask8 periodic = active
+					& _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(zr, sr)), tolv, _CMP_LT_OQ)
+					& _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(zi, si)), tolv, _CMP_LT_OQ);
+				count = _mm512_mask_blend_pd(periodic, count, itmax);
+				active &= ~periodic;
+				proven |= periodic;
+			}
+			if(tol > 0.0 && iter + 1 == check)
+			{
+				sr = zr;
+				si = zi;
+				check <<= 1;
+			}
+		}
+		_mm512_store_pd(counts, count);
+		storeCounts(counts, k, n, 8, out);
+		if(zr_io)
+		{
+			_mm512_store_pd(zs, _mm512_mask_blend_pd(proven, zr, _mm512_set1_pd(PROVEN)));
+			storeLanes(zs, k, n, 8, zr_io);
+			_mm512_store_pd(zs, zi);
+			storeLanes(zs, k, n, 8, zi_io);
+		}
+	}
+}
+#endif
+} // namespace
+
+kernels::Isa kernels::bestIsa()
+{
+#if FRACT_KERNELS_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx512f"))
+		return Isa::AVX512;
+	if(__builtin_cpu_supports("avx2"))
+		return Isa::AVX2;
+	if(__builtin_cpu_supports("sse2"))
+		return Isa::SSE2;
+#endif
+	return Isa::SCALAR;
+}
+
+kernels::Isa kernels::activeIsa()
+{
+	int isa = activeIsa_.load(std::memory_order_relaxed);
+	if(isa < 0)
+	{
+		isa = static_cast<int>(bestIsa());
+		activeIsa_.store(isa, std::memory_order_relaxed);
+	}
+	return static_cast<Isa>(isa);
+}
+
+kernels::Isa kernels::setIsa(const Isa isa)
+{
+	auto applied = std::min(static_cast<int>(isa), static_cast<int>(bestIsa()));
+	activeIsa_.store(applied, std::memory_order_relaxed);
+	return static_cast<Isa>(applied);
+}
+
+bool kernels::interiorChecks()
+{
+	return interiorChecks_.load(std::memory_order_relaxed);
+}
+
+void kernels::setInteriorChecks(const bool on)
+{
+	interiorChecks_.store(on, std::memory_order_relaxed);
+}
+
+double kernels::periodicityTol(const double spacing)
+{
+	if(!interiorChecks())
+		return 0.0;
+	// far below the pixel step, and never looser than 1e-10 so slowly
+	// escaping orbits near parabolic points are not taken as cycles
+	return std::max(std::min(spacing*1e-3, 1e-10), 1e-300);
+}
+
+const char* kernels::isaName(const Isa isa)
+{
+	switch(isa)
+	{
+		case Isa::SSE2: return "sse2";
+		case Isa::AVX2: return "avx2";
+		case Isa::AVX512: return "avx512";
+		default: return "scalar";
+	}
+}
+
+int kernels::isaLanes(const Isa isa)
+{
+	switch(isa)
+	{
+		case Isa::SSE2: return 2;
+		case Isa::AVX2: return 4;
+		case Isa::AVX512: return 8;
+		default: return 1;
+	}
+}
+
+namespace
+{
+void lutRowScalar(
+	const int* counts,
+	const int n,
+	const uint32_t* lut,
+	const int lut_size,
+	uint8_t* bgr
+)
+{
+	for(int k = 0; k < n; ++k)
+	{
+		const uint32_t c = lut[std::min(std::max(counts[k], 0), lut_size - 1)];
+		bgr[3*k] = c & 0xFF;
+		bgr[3*k + 1] = (c >> 8) & 0xFF;
+		bgr[3*k + 2] = (c >> 16) & 0xFF;
+	}
+}
+
+#if FRACT_KERNELS_X86
+FRACT_TARGET("avx2")
+void lutRowAVX2(
+	const int* counts,
+	const int n,
+	const uint32_t* lut,
+	const int lut_size,
+	uint8_t* bgr
+)
+{
+	const __m256i lo = _mm256_setzero_si256();
+	const __m256i hi = _mm256_set1_epi32(lut_size - 1);
+	// drop the 4th byte of every color, 12 bytes in each 128-bit half
+	const __m256i pack = _mm256_setr_epi8(
+		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1
+	);
+	int k = 0;
+	// the store of the upper half spills 4 bytes into pixels k + 8, k + 9,
+	// written again by the next group or the tail
+	for(; k + 10 <= n; k += 8)
+	{
+		__m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(counts + k));
+		idx = _mm256_min_epi32(_mm256_max_epi32(idx, lo), hi);
+		const __m256i c = _mm256_shuffle_epi8(
+			_mm256_i32gather_epi32(reinterpret_cast<const int*>(lut), idx, 4),
+			pack
+		);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(bgr + 3*k), _mm256_castsi256_si128(c));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(bgr + 3*k + 12), _mm256_extracti128_si256(c, 1));
+	}
+	lutRowScalar(counts + k, n - k, lut, lut_size, bgr + 3*k);
+}
+#endif
+
+void dispatch(
+	const double* cx,
+	const double* cy,
+	const int cy_step,
+	const int n,
+	const int iter_from,
+	const int iter_max,
+	double* zr_io,
+	double* zi_io,
+	int* out,
+	const double tol
+)
+{
+	switch(kernels::activeIsa())
+	{
+#if FRACT_KERNELS_X86
+		case kernels::Isa::AVX512:
+			mandelbrotRowAVX512(cx, cy, cy_step, n, iter_from, iter_max, zr_io, zi_io, out, tol);
+			return;
+		case kernels::Isa::AVX2:
+			mandelbrotRowAVX2(cx, cy, cy_step, n, iter_from, iter_max, zr_io, zi_io, out, tol);
+			return;
+		case kernels::Isa::SSE2:
+			mandelbrotRowSSE2(cx, cy, cy_step, n, iter_from, iter_max, zr_io, zi_io, out, tol);
+			return;
+#endif
+		default:
+			mandelbrotRowScalar(cx, cy, cy_step, n, iter_from, iter_max, zr_io, zi_io, out, tol);
+	}
+}
+} // namespace
+
+void kernels::mandelbrotRow(
+	const double* cx,
+	const double cy,
+	const int n,
+	const int iter_max,
+	int* out,
+	const double tol
+)
+{
+	dispatch(cx, &cy, 0, n, 0, iter_max, nullptr, nullptr, out, tol);
+}
+
+void kernels::mandelbrotPoints(
+	const double* cx,
+	const double* cy,
+	const int n,
+	const int iter_max,
+	int* out,
+	const double tol
+)
+{
+	dispatch(cx, cy, 1, n, 0, iter_max, nullptr, nullptr, out, tol);
+}
+
+void kernels::mandelbrotResume(
+	const double* cx,
+	const double* cy,
+	const int n,
+	const int iter_from,
+	const int iter_max,
+	double* zr,
+	double* zi,
+	int* out,
+	const double tol
+)
+{
+	dispatch(cx, cy, 1, n, iter_from, iter_max, zr, zi, out, tol);
+}
+
+namespace
+{
+//! @brief steps past the escape and |z|^2 to stop at, for an accurate log|z|
+const int DE_STEPS = 8;
+const double DE_RADIUS2 = 1e16;
+
+//! @brief with G = log|z_m|/2^m the Green's function of the set and G' its
+//         gradient, the distance is at least sinh(G)/(2 e^G |G'|) =
+//         (1 - e^-2G)/(4 |G'|), and G/|G'| = |z_m| log|z_m| / |dz_m|
+double koebeBound(
+	const double zr,
+	const double zi,
+	const double dr,
+	const double di,
+	const int m
+)
+{
+	// |dz|^2 only overflows for a c nearer the set than double resolves
+	const double r = std::sqrt(zr*zr + zi*zi), dz = std::sqrt(dr*dr + di*di);
+	if(!(r > 1.0) || !(dz > 0.0) || !std::isfinite(r) || !std::isfinite(dz))
+		return 0.0;
+	const double log_r = std::log(r);
+	const double g = std::ldexp(log_r, -m);
+	// (1 - e^-2G)/2G, 1 for the tiny G of all but the first iterations
+	const double shrink = g > 1e-8 ? -std::expm1(-2.0*g)/(2.0*g) : 1.0;
+	return 0.5*shrink*r*log_r/dz;
+}
+
+//! @brief mandelbrotRowScalar with dz/dc next to z, dz' = 2 z dz + 1;
+//         an escaped orbit goes on DE_STEPS past its count, or until
+//         |z|^2 >= DE_RADIUS2, for the distance
+void distanceScalar(
+	const double* cx,
+	const double* cy,
+	const int n,
+	const int iter_max,
+	int* out,
+	double* distance,
+	const double tol
+)
+{
+	for(int k = 0; k < n; ++k)
+	{
+		const double cr = cx[k], ci = cy[k];
+		distance[k] = 0.0;
+		if(tol > 0.0 && inMainComponents(cr, ci))
+		{
+			out[k] = iter_max;
+			continue;
+		}
+		double zr = 0.0, zi = 0.0, dr = 0.0, di = 0.0;
+		double sr = zr, si = zi;
+		int check = 1;
+		int iter = 0;
+		bool escaped = false;
+		while(iter < iter_max)
+		{
+			const double zr2 = zr*zr, zi2 = zi*zi;
+			if(zr2 + zi2 >= 4.0)
+			{
+				escaped = true;
+				break;
+			}
+			const double t = 2.0*(zr*dr - zi*di) + 1.0;
+			di = 2.0*(zr*di + zi*dr);
+			dr = t;
+			zi = (zr + zr)*zi + ci;
+			zr = zr2 - zi2 + cr;
+			++iter;
+			if(tol > 0.0 && (iter & 3) == 0
+				&& std::fabs(zr - sr) < tol && std::fabs(zi - si) < tol)
+			{
+				iter = iter_max;
+				break;
+			}
+			if(tol > 0.0 && iter == check)
+			{
+				sr = zr;
+				si = zi;
+				check <<= 1;
+			}
+		}
+		out[k] = iter;
+		if(!escaped)
+			continue;
+		int m = iter;
+		while(m < iter + DE_STEPS)
+		{
+			const double zr2 = zr*zr, zi2 = zi*zi;
+			if(zr2 + zi2 >= DE_RADIUS2)
+				break;
+			const double t = 2.0*(zr*dr - zi*di) + 1.0;
+			di = 2.0*(zr*di + zi*dr);
+			dr = t;
+			zi = (zr + zr)*zi + ci;
+			zr = zr2 - zi2 + cr;
+			++m;
+		}
+		distance[k] = koebeBound(zr, zi, dr, di, m);
+	}
+}
+
+#if FRACT_KERNELS_X86
+//! @brief distanceScalar four points at a time, counting as
+//         mandelbrotRowAVX2 with dz stepped next to z; z and dz of a lane
+//         are kept at its escape, the steps past it run once the group
+//         is done counting
+FRACT_TARGET("avx2")
+void distanceAVX2(
+	const double* cx,
+	const double* cy,
+	const int n,
+	const int iter_max,
+	int* out,
+	double* distance,
+	const double tol
+)
+{
+	const __m256d four = _mm256_set1_pd(4.0);
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d two = _mm256_set1_pd(2.0);
+	const __m256d radius2 = _mm256_set1_pd(DE_RADIUS2);
+	const __m256d itmax = _mm256_set1_pd(iter_max);
+	const __m256d tolv = _mm256_set1_pd(tol);
+	const __m256d sign = _mm256_set1_pd(-0.0);
+	alignas(32) double pad[4], pad_y[4], counts[4];
+	alignas(32) double ezr[4] = {}, ezi[4] = {}, edr[4] = {}, edi[4] = {}, ms[4];
+	for(int k = 0; k < n; k += 4)
+	{
+		const __m256d cr = _mm256_loadu_pd(laneGroup(cx, k, n, 4, pad));
+		const __m256d ci = _mm256_loadu_pd(laneGroup(cy, k, n, 4, pad_y));
+		const __m256d y2 = _mm256_mul_pd(ci, ci);
+		__m256d zr = _mm256_setzero_pd(), zi = _mm256_setzero_pd();
+		__m256d dr = _mm256_setzero_pd(), di = _mm256_setzero_pd();
+		__m256d sr = zr, si = zi;
+		__m256d count = _mm256_setzero_pd();
+		__m256d active = _mm256_cmp_pd(zr, zr, _CMP_EQ_OQ);
+		__m256d escaped = _mm256_setzero_pd();
+		if(tol > 0.0)
+		{
+			const __m256d xq = _mm256_sub_pd(cr, _mm256_set1_pd(0.25));
+			const __m256d q = _mm256_add_pd(_mm256_mul_pd(xq, xq), y2);
+			const __m256d xb = _mm256_add_pd(cr, one);
+			const __m256d inside = _mm256_or_pd(
+				_mm256_cmp_pd(
+					_mm256_mul_pd(q, _mm256_add_pd(q, xq)),
+					_mm256_mul_pd(_mm256_set1_pd(0.25), y2),
+					_CMP_LT_OQ
+				),
+				_mm256_cmp_pd(
+					_mm256_add_pd(_mm256_mul_pd(xb, xb), y2),
+					_mm256_set1_pd(0.0625),
+					_CMP_LT_OQ
+				)
+			);
+			count = _mm256_blendv_pd(count, itmax, inside);
+			active = _mm256_andnot_pd(inside, active);
+		}
+		int check = 1;
+		for(int iter = 0; iter < iter_max && _mm256_movemask_pd(active) != 0; ++iter)
+		{
+			const __m256d zr2 = _mm256_mul_pd(zr, zr);
+			const __m256d zi2 = _mm256_mul_pd(zi, zi);
+			const __m256d inside = _mm256_cmp_pd(_mm256_add_pd(zr2, zi2), four, _CMP_LT_OQ);
+			const __m256d out_now = _mm256_andnot_pd(inside, active);
+			if(_mm256_movemask_pd(out_now) != 0)
+			{
+				// once per lane at most, the values the distance is taken from
+				_mm256_store_pd(ezr, _mm256_blendv_pd(_mm256_load_pd(ezr), zr, out_now));
+				_mm256_store_pd(ezi, _mm256_blendv_pd(_mm256_load_pd(ezi), zi, out_now));
+				_mm256_store_pd(edr, _mm256_blendv_pd(_mm256_load_pd(edr), dr, out_now));
+				_mm256_store_pd(edi, _mm256_blendv_pd(_mm256_load_pd(edi), di, out_now));
+				escaped = _mm256_or_pd(escaped, out_now);
+				active = _mm256_and_pd(active, inside);
+				if(_mm256_movemask_pd(active) == 0)
+					break;
+			}
+			count = _mm256_add_pd(count, _mm256_and_pd(active, one));
+			// dz' = 2 z dz + 1 from the z before the step
+			const __m256d ndr = _mm256_add_pd(_mm256_mul_pd(two, _mm256_sub_pd(
+				_mm256_mul_pd(zr, dr),
+				_mm256_mul_pd(zi, di)
+			)), one);
+			di = _mm256_mul_pd(two, _mm256_add_pd(
+				_mm256_mul_pd(zr, di),
+				_mm256_mul_pd(zi, dr)
+			));
+			dr = ndr;
+			zi = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(zr, zr), zi), ci);
+			zr = _mm256_add_pd(_mm256_sub_pd(zr2, zi2), cr);
+			if(tol > 0.0 && ((iter + 1) & 3) == 0)
+			{
+				const __m256d periodic = _mm256_and_pd(active, _mm256_and_pd(
+					_mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(zr, sr)), tolv, _CMP_LT_OQ),
+					_mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(zi, si)), tolv, _CMP_LT_OQ)
+				));
+				count = _mm256_blendv_pd(count, itmax, periodic);
+				active = _mm256_andnot_pd(periodic, active);
+			}
+			if(tol > 0.0 && iter + 1 == check)
+			{
+				sr = zr;
+				si = zi;
+				check <<= 1;
+			}
+		}
+		_mm256_store_pd(counts, count);
+		storeCounts(counts, k, n, 4, out);
+		const int escapes = _mm256_movemask_pd(escaped);
+		if(escapes == 0)
+		{
+			for(int j = 0; j < 4 && k + j < n; ++j)
+				distance[k + j] = 0.0;
+			continue;
+		}
+		// DE_STEPS past the escape of every lane, or to |z|^2 >= DE_RADIUS2
+		zr = _mm256_load_pd(ezr);
+		zi = _mm256_load_pd(ezi);
+		dr = _mm256_load_pd(edr);
+		di = _mm256_load_pd(edi);
+		__m256d m = count;
+		__m256d live = escaped;
+		for(int step = 0; step < DE_STEPS; ++step)
+		{
+			const __m256d zr2 = _mm256_mul_pd(zr, zr);
+			const __m256d zi2 = _mm256_mul_pd(zi, zi);
+			live = _mm256_and_pd(live, _mm256_cmp_pd(_mm256_add_pd(zr2, zi2), radius2, _CMP_LT_OQ));
+			if(_mm256_movemask_pd(live) == 0)
+				break;
+			m = _mm256_add_pd(m, _mm256_and_pd(live, one));
+			const __m256d ndr = _mm256_add_pd(_mm256_mul_pd(two, _mm256_sub_pd(
+				_mm256_mul_pd(zr, dr),
+				_mm256_mul_pd(zi, di)
+			)), one);
+			const __m256d ndi = _mm256_mul_pd(two, _mm256_add_pd(
+				_mm256_mul_pd(zr, di),
+				_mm256_mul_pd(zi, dr)
+			));
+			const __m256d nzi = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(zr, zr), zi), ci);
+			const __m256d nzr = _mm256_add_pd(_mm256_sub_pd(zr2, zi2), cr);
+			dr = _mm256_blendv_pd(dr, ndr, live);
+			di = _mm256_blendv_pd(di, ndi, live);
+			zi = _mm256_blendv_pd(zi, nzi, live);
+			zr = _mm256_blendv_pd(zr, nzr, live);
+		}
+		_mm256_store_pd(ezr, zr);
+		_mm256_store_pd(ezi, zi);
+		_mm256_store_pd(edr, dr);
+		_mm256_store_pd(edi, di);
+		_mm256_store_pd(ms, m);
+		for(int j = 0; j < 4 && k + j < n; ++j)
+			distance[k + j] = (escapes >> j) & 1
+				? koebeBound(ezr[j], ezi[j], edr[j], edi[j], static_cast<int>(ms[j]))
+				: 0.0;
+	}
+}
+#endif
+} // namespace
+
+void kernels::mandelbrotDistance(
+	const double* cx,
+	const double* cy,
+	const int n,
+	const int iter_max,
+	int* out,
+	double* distance,
+	const double tol
+)
+{
+	// the derivative rides along in the escape loop, six multiplies and
+	// three adds a step, no second pass over the escaped orbits
+#if FRACT_KERNELS_X86
+	if(activeIsa() >= Isa::AVX2)
+	{
+		distanceAVX2(cx, cy, n, iter_max, out, distance, tol);
+		return;
+	}
+#endif
+	distanceScalar(cx, cy, n, iter_max, out, distance, tol);
+}
+
+void kernels::lutRow(
+	const int* counts,
+	const int n,
+	const uint32_t* lut,
+	const int lut_size,
+	uint8_t* bgr
+)
+{
+#if FRACT_KERNELS_X86
+	if(activeIsa() >= Isa::AVX2)
+	{
+		lutRowAVX2(counts, n, lut, lut_size, bgr);
+		return;
+	}
+#endif
+	lutRowScalar(counts, n, lut, lut_size, bgr);
+}
@@ -0,0 +1,109 @@
+#ifndef FRACT_KERNELS_H
+#define FRACT_KERNELS_H
+
+#include <cstdint>
+
+namespace FRACTAL
+{
+namespace kernels
+{
+//! @brief instruction sets the escape-time kernels are compiled for
+enum class Isa
+{
+    SCALAR = 0,
+    SSE2 = 1,
+    AVX2 = 2,
+    AVX512 = 3
+};
+
+//! @brief widest instruction set supported by the running cpu
+Isa bestIsa();
+//! @brief instruction set used by the kernels (bestIsa() by default)
+Isa activeIsa();
+//! @brief force an instruction set, clamped to bestIsa(); returns the one applied
+Isa setIsa(const Isa isa);
+const char* isaName(const Isa isa);
+//! @brief number of pixels one instruction evaluates for the isa
+int isaLanes(const Isa isa);
+
+//! @brief main cardioid / period-2 bulb and periodicity checks,
+//         on by default; they never change a count
+bool interiorChecks();
+void setInteriorChecks(const bool on);
+//! @brief orbit distance below which two points of a cycle are taken
+//         as equal, for a pixel step of spacing; 0 with checks off
+double periodicityTol(const double spacing);
+
+//! @brief escape-time counts of z*z + c for one row of pixels,
+//         c = (cx[k], cy), k in [0, n); out[k] gets the same count as
+//         Fract::escape with th = 2.0.
+//         Points inside the cardioid/bulb and orbits that come back within
+//         tol of a Brent checkpoint are reported as iter_max right away,
+//         tol = 0 disables both
+void mandelbrotRow(
+    const double* cx,
+    const double cy,
+    const int n,
+    const int iter_max,
+    int* out,
+    const double tol = 0.0
+);
+
+//! @brief same counts as mandelbrotRow for scattered points
+//         c = (cx[k], cy[k]), k in [0, n)
+void mandelbrotPoints(
+    const double* cx,
+    const double* cy,
+    const int n,
+    const int iter_max,
+    int* out,
+    const double tol = 0.0
+);
+
+//! @brief mandelbrotPoints continued from an earlier call: zr/zi hold
+//         z of every point after iter_from <= iter_max iterations (not
+//         read for iter_from = 0) and get z where the point stopped.
+//         Same counts as a run from 0; z is meaningful for the points
+//         still running at iter_max only, zr is NaN for those the
+//         interior checks proved never to escape
+void mandelbrotResume(
+    const double* cx,
+    const double* cy,
+    const int n,
+    const int iter_from,
+    const int iter_max,
+    double* zr,
+    double* zi,
+    int* out,
+    const double tol = 0.0
+);
+
+//! @brief mandelbrotPoints counts and a lower bound of the distance
+//         from every c to the set, in units of c: 0 for the points that
+//         reach iter_max. The derivative dz/dc is stepped next to z in
+//         the escape loop, and an escaped orbit a few steps past |z| = 2
+//         so that log|z| is accurate; the bound is the Koebe 1/4 one,
+//         the true distance is at most 4 times it
+void mandelbrotDistance(
+    const double* cx,
+    const double* cy,
+    const int n,
+    const int iter_max,
+    int* out,
+    double* distance,
+    const double tol = 0.0
+);
+
+//! @brief bgr bytes of n counts through a table of lut_size packed
+//         0x00RRGGBB colors; counts are clamped to [0, lut_size)
+void lutRow(
+    const int* counts,
+    const int n,
+    const uint32_t* lut,
+    const int lut_size,
+    uint8_t* bgr
+);
+} // namespace kernels
+} // namespace FRACTAL
+
+#endif // FRACT_KERNELS_H
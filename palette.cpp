@@ -0,0 +1,215 @@
+#include <algorithm>
+
+#include "fract.h"
+#include "kernels.h"
+#include "palette.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+namespace
+{
+//! @brief tables kept: previews, anti-aliasing and the frames in flight
+//         of fractal_batch each may color with their own iter_max
+const size_t LUT_SLOTS = 8;
+
+std::tuple<int, int, int> get_rgb_piecewise_linear(int n, int iter_max) {
+	int N = 256; // colors per element
+	int N3 = N * N * N;
+	// map n on the 0..1 interval (real numbers)
+	double t = (double)n/(double)iter_max;
+	// expand n on the 0 .. 256^3 interval (integers)
+	n = (int)(t * (double) N3);
+	int b = n/(N * N);
+	int nn = n - b * N * N;
+	int r = nn/N;
+	int g = nn - r * N;
+	return std::tuple<int, int, int>(r, g, b);
+}
+
+std::tuple<int, int, int> iters2rgbBernsteinPoly(
+	const int n, 
+	const int iter_max
+) 
+{
+	// map n on the 0..1 interval
+	double t = (double)n/(double)iter_max;
+	int r = (int)(42*(1-t)*t*255);
+	int g = (int)(11*(1-t)*(1-t)*3*t*t*255);
+	int b =  (int)(22.5*(1-t)*(1-t)*(1-t)*t*255);	
+	// int r = (int)(42*(1-t)*t*255);
+	// int g = (int)(15*(1-t)*(1-t)*t*t*255);
+	// int b =  (int)(2.5*(1-t)*(1-t)*(1-t)*t*255);	
+	return std::tuple<int, int, int>(r, g, b);
+	
+}
+
+//! @brief saturated like the cv::Scalar colors plot used to draw with
+uint32_t pack(const std::tuple<int, int, int>& rgb)
+{
+	auto sat = [](const int v) -> uint32_t { return std::min(std::max(v, 0), 255); };
+	return sat(std::get<2>(rgb)) | sat(std::get<1>(rgb)) << 8 | sat(std::get<0>(rgb)) << 16;
+}
+} // namespace
+
+FRACTAL::Palette::Palette(const Kind kind)
+: _kind(kind)
+{}
+
+FRACTAL::Palette::Palette(
+	const Kind kind,
+	const Rgb& rgb_c,
+	const Rgb& rgb_t,
+	const Rgb& rgb_1_t
+)
+: _kind(kind)
+, _c(rgb_c)
+, _t(rgb_t)
+, _1_t(rgb_1_t)
+{}
+
+Palette FRACTAL::Palette::bernstein(const Rgb& rgb_c, const Rgb& rgb_t, const Rgb& rgb_1_t)
+{
+	return Palette(BERNSTEIN, rgb_c, rgb_t, rgb_1_t);
+}
+
+const Palette& FRACTAL::Palette::forSmooth(const bool smooth_color)
+{
+	static const Palette smooth(BERNSTEIN_POLY), linear(PIECEWISE_LINEAR);
+	return smooth_color ? smooth : linear;
+}
+
+std::tuple<int, int, int> FRACTAL::Palette::rgb(const int n, const int iter_max) const
+{
+	switch(_kind)
+	{
+		case PIECEWISE_LINEAR:
+			return get_rgb_piecewise_linear(n, iter_max);
+		case BERNSTEIN:
+			return Fract::iters2rgbBernstein(n, iter_max, _c, _t, _1_t);
+		default:
+			return iters2rgbBernsteinPoly(n, iter_max);
+	}
+}
+
+std::shared_ptr<const std::vector<uint32_t>> FRACTAL::Palette::lut(const int iter_max) const
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	for(auto it = _luts.begin(); it != _luts.end(); ++it)
+	{
+		if(it->first == iter_max)
+		{
+			_luts.splice(_luts.begin(), _luts, it);
+			return it->second;
+		}
+	}
+	const size_t size = std::max(iter_max, 0) + 1;
+	auto lut = std::make_shared<std::vector<uint32_t>>(size);
+	for(size_t n = 0; n < size; ++n)
+		(*lut)[n] = pack(rgb(static_cast<int>(n), iter_max));
+	_luts.emplace_front(iter_max, lut);
+	if(_luts.size() > LUT_SLOTS)
+		_luts.pop_back();
+	return lut;
+}
+
+void FRACTAL::Palette::colorize(
+	const std::vector<int>& counts,
+	const int width,
+	const int height,
+	const int iter_max,
+	cv::Mat& bgr
+) const
+{
+	colorize(counts.data(), width, height, iter_max, bgr);
+}
+
+void FRACTAL::Palette::colorize(
+	const int* counts,
+	const int width,
+	const int height,
+	const int iter_max,
+	cv::Mat& bgr
+) const
+{
+	bgr.create(height, width, CV_8UC3);
+	const auto table = lut(iter_max);
+	const int size = static_cast<int>(table->size());
+	cv::parallel_for_(
+		cv::Range(0, height),
+		[&](const cv::Range& rows) -> void
+		{
+			for(int y = rows.start; y < rows.end; ++y)
+				kernels::lutRow(&counts[y*width], width, table->data(), size, bgr.ptr<uint8_t>(y));
+		}
+	);
+}
+
+void FRACTAL::Palette::colorize(
+	const uint16_t* counts,
+	const int width,
+	const int height,
+	const int iter_max,
+	cv::Mat& bgr
+) const
+{
+	bgr.create(height, width, CV_8UC3);
+	const auto table = lut(iter_max);
+	const int last = static_cast<int>(table->size()) - 1;
+	const uint32_t* colors = table->data();
+	cv::parallel_for_(
+		cv::Range(0, height),
+		[&](const cv::Range& rows) -> void
+		{
+			for(int y = rows.start; y < rows.end; ++y)
+			{
+				const uint16_t* n = counts + static_cast<size_t>(y)*width;
+				uint8_t* out = bgr.ptr<uint8_t>(y);
+				for(int k = 0; k < width; ++k)
+				{
+					const uint32_t c = colors[std::min<int>(n[k], last)];
+					out[3*k] = c & 0xFF;
+					out[3*k + 1] = (c >> 8) & 0xFF;
+					out[3*k + 2] = (c >> 16) & 0xFF;
+				}
+			}
+		}
+	);
+}
+
+void FRACTAL::Palette::colorize(
+	const float* smooth,
+	const int width,
+	const int height,
+	const int iter_max,
+	cv::Mat& bgr
+) const
+{
+	bgr.create(height, width, CV_8UC3);
+	const auto table = lut(iter_max);
+	const int last = static_cast<int>(table->size()) - 1;
+	const uint32_t* colors = table->data();
+	cv::parallel_for_(
+		cv::Range(0, height),
+		[&](const cv::Range& rows) -> void
+		{
+			for(int y = rows.start; y < rows.end; ++y)
+			{
+				const float* nu = smooth + static_cast<size_t>(y)*width;
+				uint8_t* out = bgr.ptr<uint8_t>(y);
+				for(int k = 0; k < width; ++k)
+				{
+					const float v = std::min(std::max(nu[k], 0.0f), static_cast<float>(last));
+					const int n = std::min(static_cast<int>(v), last);
+					const float f = v - n;
+					const uint32_t a = colors[n], b = colors[std::min(n + 1, last)];
+					for(int ch = 0; ch < 3; ++ch)
+					{
+						const float ca = (a >> (8*ch)) & 0xFF, cb = (b >> (8*ch)) & 0xFF;
+						out[3*k + ch] = static_cast<uint8_t>(ca + f*(cb - ca) + 0.5f);
+					}
+				}
+			}
+		}
+	);
+}
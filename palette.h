@@ -0,0 +1,93 @@
+#ifndef FRACT_PALETTE_H
+#define FRACT_PALETTE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace FRACTAL
+{
+//! @brief escape count -> color through a lookup table
+//
+//  The colors of all counts 0..iter_max are computed once per iter_max
+//  and kept packed as 0x00RRGGBB, the tables of the last few iter_max
+//  side by side for frames colored at once. Coloring a frame is a gather
+//  per pixel written straight into the CV_8UC3 rows (kernels::lutRow).
+class Palette
+{
+public:
+    enum Kind
+    {
+        PIECEWISE_LINEAR,
+        BERNSTEIN_POLY,
+        BERNSTEIN
+    };
+    typedef std::tuple<double, double, double> Rgb;
+
+    explicit Palette(const Kind kind = BERNSTEIN_POLY);
+    //! @brief Fract::iters2rgbBernstein with the given coefficients
+    static Palette bernstein(const Rgb& rgb_c, const Rgb& rgb_t, const Rgb& rgb_1_t);
+
+    //! @brief the palette used by Fract::plot for smooth_color
+    static const Palette& forSmooth(const bool smooth_color);
+
+    Kind kind() const { return _kind; }
+    //! @brief r, g, b of count n, not clamped to 0..255
+    std::tuple<int, int, int> rgb(const int n, const int iter_max) const;
+
+    //! @brief table of iter_max + 1 packed colors, built on first use
+    //         of that iter_max
+    std::shared_ptr<const std::vector<uint32_t>> lut(const int iter_max) const;
+
+    //! @brief color counts (width x height, row by row) into bgr,
+    //         (re)allocated as height x width CV_8UC3
+    void colorize(
+        const std::vector<int>& counts,
+        const int width,
+        const int height,
+        const int iter_max,
+        cv::Mat& bgr
+    ) const;
+    //! @brief same from a raw buffer, e.g. an IterDump mapped from disk
+    void colorize(
+        const int* counts,
+        const int width,
+        const int height,
+        const int iter_max,
+        cv::Mat& bgr
+    ) const;
+    //! @brief 16-bit counts (CompactCounts, IterDump::counts16): half the
+    //         bytes of the int buffers to read
+    void colorize(
+        const uint16_t* counts,
+        const int width,
+        const int height,
+        const int iter_max,
+        cv::Mat& bgr
+    ) const;
+    //! @brief fractional counts (IterDump::smooth): every pixel blends
+    //         the colors of the two counts around its value
+    void colorize(
+        const float* smooth,
+        const int width,
+        const int height,
+        const int iter_max,
+        cv::Mat& bgr
+    ) const;
+
+private:
+    Palette(const Kind kind, const Rgb& rgb_c, const Rgb& rgb_t, const Rgb& rgb_1_t);
+    Kind _kind;
+    Rgb _c, _t, _1_t;
+    mutable std::mutex _lock;
+    //! @brief most recently used first, at most LUT_SLOTS tables
+    mutable std::list<std::pair<int, std::shared_ptr<const std::vector<uint32_t>>>> _luts;
+};
+} // namespace FRACTAL
+
+#endif // FRACT_PALETTE_H
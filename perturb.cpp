@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+#include "perturb.h"
+#include "scheduler.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+// DeepCS
+FRACTAL::DeepCS::DeepCS(
+	const CS<double>& fr,
+	const int limbs
+)
+: x_min(BigFixed::fromDouble(fr.x_min(), limbs))
+, y_min(BigFixed::fromDouble(fr.y_min(), limbs))
+, width(fr.width())
+, height(fr.height())
+{}
+
+void FRACTAL::DeepCS::zoom(
+	const CS<int>& scr,
+	const double window_ratio,
+	const double x1,
+	const double x2,
+	const double y1
+)
+{
+	const double sx = width / scr.width();
+	const double sy = height / scr.height();
+	x_min += BigFixed::fromDouble(x1*sx, x_min.limbs());
+	y_min += BigFixed::fromDouble(y1*sy, y_min.limbs());
+	width = (x2 - x1)*sx;
+	height = width*window_ratio;
+	const int limbs = BigFixed::limbsFor(width / scr.width());
+	if(limbs > x_min.limbs())
+	{
+		x_min = x_min.withLimbs(limbs);
+		y_min = y_min.withLimbs(limbs);
+	}
+}
+
+CS<double> FRACTAL::DeepCS::toCS() const
+{
+	const double x = x_min.toDouble(), y = y_min.toDouble();
+	return CS<double>(x, x + width, y, y + height);
+}
+
+CS<DDouble> FRACTAL::DeepCS::toDDCS() const
+{
+	const double xh = x_min.toDouble(), yh = y_min.toDouble();
+	const DDouble x(xh, (x_min - BigFixed::fromDouble(xh, x_min.limbs())).toDouble());
+	const DDouble y(yh, (y_min - BigFixed::fromDouble(yh, y_min.limbs())).toDouble());
+	return CS<DDouble>(x, x + width, y, y + height);
+}
+
+// ReferenceOrbit
+void FRACTAL::ReferenceOrbit::compute(
+	const BigFixed& cr,
+	const BigFixed& ci,
+	const int iter_max,
+	const CancelToken* cancel
+)
+{
+	zr.clear();
+	zi.clear();
+	glitch_mag.clear();
+	BigFixed r(cr.limbs()), i(cr.limbs());
+	for(int n = 0; n <= iter_max; ++n)
+	{
+		const double dr = r.toDouble(), di = i.toDouble();
+		zr.push_back(dr);
+		zi.push_back(di);
+		const double mag = dr*dr + di*di;
+		glitch_mag.push_back(mag*Perturbation::GLITCH_TOL);
+		if(mag >= 4.0)
+			break;
+		// serial and long on deep windows, a superseded render stops it
+		if(cancel && (n & 1023) == 1023 && cancel->cancelled())
+			break;
+		const BigFixed r2 = r*r, i2 = i*i, ri = r*i;
+		i = ri + ri + ci;
+		r = r2 - i2 + cr;
+	}
+}
+
+// Perturbation
+int FRACTAL::Perturbation::escape(
+	const ReferenceOrbit& ref,
+	const double dcr,
+	const double dci,
+	const int iter_max,
+	const bool detect_glitch
+)
+{
+	const int last = ref.last();
+	double dr = 0.0, di = 0.0;
+	for(int n = 0; n < iter_max; ++n)
+	{
+		const double Zr = ref.zr[n], Zi = ref.zi[n];
+		const double zr = Zr + dr, zi = Zi + di;
+		const double mag = zr*zr + zi*zi;
+		if(mag >= 4.0)
+			return n;
+		// the reference escaped first or z passed too close to zero
+		if(n == last || (detect_glitch && mag < ref.glitch_mag[n]))
+			return PENDING;
+		const double ndr = 2.0*(Zr*dr - Zi*di) + dr*dr - di*di + dcr;
+		di = 2.0*(Zr*di + Zi*dr) + 2.0*dr*di + dci;
+		dr = ndr;
+	}
+	return iter_max;
+}
+
+int FRACTAL::Perturbation::render(
+	const CS<int> &scr,
+	const DeepCS &fr,
+	int iter_max,
+	std::vector<int> &colors,
+	const Fract::RenderOptions &opts
+)
+{
+	const int max_references = opts.deep_max_references;
+	const int width = scr.width(), height = scr.height();
+	const double sx = fr.width / width, sy = fr.height / height;
+	std::fill(colors.begin(), colors.end(), PENDING);
+	// the first reference sits in the middle of the frame
+	double rx = width/2, ry = height/2;
+	double ref_x = rx, ref_y = ry;
+	ReferenceOrbit ref;
+	int references = 0;
+	size_t pending = colors.size();
+	while(pending > 0 && references < max_references)
+	{
+		ref.compute(
+			fr.x_min + rx*sx,
+			fr.y_min + ry*sy,
+			iter_max,
+			opts.cancel.get()
+		);
+		ref_x = rx;
+		ref_y = ry;
+		++references;
+		if(references == 1)
+		{
+			// every pixel is pending, glitches never look uniform
+			Fract::renderPixels(
+				scr,
+				colors,
+				[&](const int* xs, const int* ys, int n, int* out) -> void
+				{
+					for(int k = 0; k < n; ++k)
+						out[k] = escape(ref, (xs[k] - rx)*sx, (ys[k] - ry)*sy, iter_max, true);
+				},
+				opts
+			);
+		}
+		else
+		{
+			Scheduler::run(
+				Scheduler::tiles(cv::Rect(0, 0, width, height), opts.tile),
+				std::vector<double>(),
+				[&](const cv::Rect& tile, const size_t) -> void
+				{
+					for(int y = tile.y; y < tile.y + tile.height; ++y)
+					{
+						int* row = &colors[y*width];
+						for(int x = tile.x; x < tile.x + tile.width; ++x)
+						{
+							if(row[x] == PENDING)
+								row[x] = escape(ref, (x - rx)*sx, (y - ry)*sy, iter_max, true);
+						}
+					}
+				},
+				opts.threads,
+				opts.cancel.get()
+			);
+		}
+		if(opts.cancelled())
+			return references;
+		// next reference: the pending pixel nearest to their centroid
+		double mx = 0.0, my = 0.0;
+		pending = 0;
+		for(size_t k = 0; k < colors.size(); ++k)
+		{
+			if(colors[k] != PENDING)
+				continue;
+			mx += k % width;
+			my += k / width;
+			++pending;
+		}
+		if(pending == 0)
+			break;
+		mx /= pending;
+		my /= pending;
+		double best = std::numeric_limits<double>::max();
+		for(size_t k = 0; k < colors.size(); ++k)
+		{
+			if(colors[k] != PENDING)
+				continue;
+			const double dx = double(k % width) - mx, dy = double(k / width) - my;
+			if(dx*dx + dy*dy < best)
+			{
+				best = dx*dx + dy*dy;
+				rx = k % width;
+				ry = k / width;
+			}
+		}
+		cout << "Perturbation::reference " << references
+			 << "::glitched " << pending << endl;
+	}
+	if(pending > 0)
+	{
+		// out of references, keep what the last orbit can give
+		for(size_t k = 0; k < colors.size(); ++k)
+		{
+			if(colors[k] != PENDING)
+				continue;
+			const int x = k % width, y = k / width;
+			int n = escape(ref, (x - ref_x)*sx, (y - ref_y)*sy, iter_max, false);
+			colors[k] = n == PENDING ? iter_max : n;
+		}
+		cout << "Perturbation::unresolved glitches::" << pending << endl;
+	}
+	return references;
+}
@@ -0,0 +1,64 @@
+#ifndef FRACT_PERTURB_H
+#define FRACT_PERTURB_H
+
+#include <vector>
+
+#include "bigfixed.h"
+#include "fract.h"
+
+namespace FRACTAL
+{
+//! @brief orbit Z_n of z*z + c iterated in BigFixed and kept in double
+//
+//  Pixels are iterated as double deltas from it:
+//      d_{n+1} = 2*Z_n*d_n + d_n^2 + dc,  z_n = Z_n + d_n
+struct ReferenceOrbit
+{
+    //! @brief the orbit of c up to iter_max; cut short, unusable, once
+    //         cancel is set
+    void compute(
+        const BigFixed& cr,
+        const BigFixed& ci,
+        const int iter_max,
+        const CancelToken* cancel = nullptr
+    );
+    std::vector<double> zr, zi;
+    //! @brief |Z_n|^2 scaled by the glitch tolerance
+    std::vector<double> glitch_mag;
+    //! @brief last index a delta can be stepped from
+    int last() const { return static_cast<int>(zr.size()) - 1; }
+};
+
+struct Perturbation
+{
+    //! @brief marks pixels that still need a reference
+    static const int PENDING = -1;
+    //! @brief |z|^2 < tol*|Z|^2 means the delta lost its precision
+    static constexpr double GLITCH_TOL = 1e-6;
+
+    //! @brief escape-time counts of z*z + c on a deep window; pixels that
+    //         glitch are re-rendered from a new reference picked among
+    //         them, up to opts.deep_max_references orbits; the first
+    //         reference fills the frame by subdivision if opts.subdivide;
+    //         returns the orbits used
+    static int render(
+        const CS<int> &scr,
+        const DeepCS &fr,
+        int iter_max,
+        std::vector<int> &colors,
+        const Fract::RenderOptions &opts = Fract::RenderOptions()
+    );
+
+    //! @brief count for one pixel at delta (dcr, dci) from the reference,
+    //         PENDING if detect_glitch and the delta can't be trusted
+    static int escape(
+        const ReferenceOrbit& ref,
+        const double dcr,
+        const double dci,
+        const int iter_max,
+        const bool detect_glitch
+    );
+};
+} // namespace FRACTAL
+
+#endif // FRACT_PERTURB_H
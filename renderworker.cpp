@@ -0,0 +1,115 @@
+#include <exception>
+#include <iostream>
+
+#include "renderworker.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+FRACTAL::RenderWorker::RenderWorker()
+: _thread(&RenderWorker::run, this)
+{}
+
+FRACTAL::RenderWorker::~RenderWorker()
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_stop = true;
+		if(_running_cancel)
+			_running_cancel->cancel();
+		_pending = nullptr;
+	}
+	_wake.notify_all();
+	_thread.join();
+}
+
+size_t FRACTAL::RenderWorker::submit(const Job& job)
+{
+	size_t id = 0;
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		if(_running_cancel)
+			_running_cancel->cancel();
+		if(_pending)
+			cout << "RenderWorker::dropped job " << _pending_job << endl;
+		_pending = job;
+		_pending_job = id = ++_next_job;
+		_pending_cancel = std::make_shared<CancelToken>();
+	}
+	_wake.notify_all();
+	return id;
+}
+
+void FRACTAL::RenderWorker::publish(
+	const size_t job,
+	const cv::Mat& image,
+	const bool complete
+)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	if(job < _latest.job)
+		return;
+	_latest.image = image;
+	_latest.job = job;
+	_latest.complete = complete;
+	++_serial;
+}
+
+bool FRACTAL::RenderWorker::latest(Frame& frame, size_t& seen) const
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	if(_serial == seen)
+		return false;
+	frame = _latest;
+	seen = _serial;
+	return true;
+}
+
+void FRACTAL::RenderWorker::wait()
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	_idle.wait(lock, [this]() { return !_pending && !_running; });
+}
+
+bool FRACTAL::RenderWorker::busy() const
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _pending || _running;
+}
+
+void FRACTAL::RenderWorker::run()
+{
+	for(;;)
+	{
+		Job job;
+		size_t id = 0;
+		std::shared_ptr<CancelToken> cancel;
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			_wake.wait(lock, [this]() { return _stop || _pending; });
+			if(_stop)
+				return;
+			job.swap(_pending);
+			id = _pending_job;
+			cancel = _pending_cancel;
+			_running_cancel = cancel;
+			_running = true;
+		}
+		try
+		{
+			job(cancel, id);
+		}
+		catch(const std::exception& e)
+		{
+			cout << "RenderWorker::job " << id << " failed::" << e.what() << endl;
+		}
+		if(cancel->cancelled())
+			cout << "RenderWorker::cancelled job " << id << endl;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_running = false;
+			_running_cancel.reset();
+		}
+		_idle.notify_all();
+	}
+}
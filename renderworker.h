@@ -0,0 +1,74 @@
+#ifndef FRACT_RENDERWORKER_H
+#define FRACT_RENDERWORKER_H
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <opencv2/core.hpp>
+
+#include "scheduler.h"
+
+namespace FRACTAL
+{
+//! @brief runs render jobs on a thread of its own, away from the ui
+//
+//  Only the newest job matters: submit() cancels the running job through
+//  its token (checked by the scheduler at every tile) and replaces any job
+//  still waiting, so a burst of requests never queues stale renders. Jobs
+//  publish the images they make, coarse passes included; the ui polls
+//  latest() and always gets the newest one.
+class RenderWorker
+{
+public:
+    //! @brief job number, given by submit(), starting at 1
+    typedef std::function<void(const std::shared_ptr<const CancelToken>& cancel, const size_t job)> Job;
+
+    struct Frame
+    {
+        cv::Mat image;
+        size_t job = 0;
+        //! @brief false for a coarse pass
+        bool complete = false;
+    };
+
+    RenderWorker();
+    //! @brief cancels the running job and waits for it
+    ~RenderWorker();
+    RenderWorker(const RenderWorker&) = delete;
+    RenderWorker& operator=(const RenderWorker&) = delete;
+
+    //! @brief run job next, cancelling the one running; returns its number
+    size_t submit(const Job& job);
+
+    //! @brief called by a job: the image becomes the latest frame unless a
+    //         newer job already published one
+    void publish(const size_t job, const cv::Mat& image, const bool complete);
+
+    //! @brief the newest frame, false if it was already seen
+    bool latest(Frame& frame, size_t& seen) const;
+
+    //! @brief block until no job is running or waiting
+    void wait();
+    bool busy() const;
+
+private:
+    void run();
+
+    mutable std::mutex _lock;
+    std::condition_variable _wake, _idle;
+    Job _pending;
+    size_t _pending_job = 0;
+    std::shared_ptr<CancelToken> _pending_cancel, _running_cancel;
+    bool _running = false;
+    bool _stop = false;
+    size_t _next_job = 0;
+    Frame _latest;
+    size_t _serial = 0;
+    std::thread _thread;
+};
+} // namespace FRACTAL
+
+#endif // FRACT_RENDERWORKER_H
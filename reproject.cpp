@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "reproject.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+namespace
+{
+//! @brief sample points closer than this (in new pixels) are the same
+const double SAME_POINT = 1e-6;
+} // namespace
+
+Reprojection FRACTAL::Reprojection::map(
+	const CS<int> &scr,
+	const std::vector<int> &from,
+	const int from_iter_max,
+	const double off_x,
+	const double off_y,
+	const double scale_x,
+	const double scale_y,
+	const int iter_max
+)
+{
+	const int width = scr.width(), height = scr.height();
+	Reprojection out;
+	out.iter_max = iter_max;
+	out.counts.assign(width*height, NO_HINT);
+	out.exact.assign(width*height, 0);
+	out.side.assign(width*height, UNKNOWN);
+	if(from.size() != out.counts.size())
+		return out;
+	// the side of the old samples around (u, v): all escaped or all not
+	auto sideOf = [&](const double u, const double v) -> uint8_t
+	{
+		const int u0 = static_cast<int>(std::floor(u)), v0 = static_cast<int>(std::floor(v));
+		if(u0 < 0 || v0 < 0 || u0 + 1 >= width || v0 + 1 >= height)
+			return UNKNOWN;
+		int escaped = 0, inside = 0;
+		for(const int p : {v0*width + u0, v0*width + u0 + 1, (v0 + 1)*width + u0, (v0 + 1)*width + u0 + 1})
+		{
+			if(from[p] < 0)
+				return UNKNOWN;
+			if(from[p] < from_iter_max)
+				++escaped;
+			else
+				++inside;
+		}
+		return escaped == 4 ? EXTERIOR : inside == 4 ? INTERIOR : UNKNOWN;
+	};
+	const double tol_x = SAME_POINT*std::fabs(scale_x);
+	const double tol_y = SAME_POINT*std::fabs(scale_y);
+	for(int y = 0; y < height; ++y)
+	{
+		const double v = off_y + y*scale_y;
+		const double vi = std::round(v);
+		if(vi < 0 || vi >= height)
+			continue;
+		const bool row_exact = std::fabs(v - vi) <= tol_y;
+		for(int x = 0; x < width; ++x)
+		{
+			const double u = off_x + x*scale_x;
+			const double ui = std::round(u);
+			if(ui < 0 || ui >= width)
+				continue;
+			const int p = y*width + x;
+			const int count = from[static_cast<int>(vi)*width + static_cast<int>(ui)];
+			out.counts[p] = count;
+			if(!row_exact || std::fabs(u - ui) > tol_x || count < 0)
+			{
+				out.side[p] = sideOf(u, v);
+				continue;
+			}
+			// an escaped count holds for any iter_max, an unescaped one
+			// only up to the iter_max it was computed with
+			if(count < from_iter_max)
+				out.counts[p] = std::min(count, iter_max);
+			else if(iter_max <= from_iter_max)
+				out.counts[p] = iter_max;
+			else
+			{
+				out.side[p] = sideOf(u, v);
+				continue;
+			}
+			out.exact[p] = 1;
+			++out.exact_count;
+		}
+	}
+	cout << cv::format(
+		"Reprojection::exact %.1f%%",
+		100.0*out.exact_count/std::max<size_t>(out.counts.size(), 1)
+	) << endl;
+	return out;
+}
+
+Reprojection FRACTAL::Reprojection::map(
+	const CS<int> &scr,
+	const std::vector<int> &from,
+	const int from_iter_max,
+	const CS<double> &from_fract,
+	const CS<double> &to_fract,
+	const int iter_max
+)
+{
+	const double sx = from_fract.width()/scr.width();
+	const double sy = from_fract.height()/scr.height();
+	return map(
+		scr,
+		from,
+		from_iter_max,
+		(to_fract.x_min() - from_fract.x_min())/sx,
+		(to_fract.y_min() - from_fract.y_min())/sy,
+		to_fract.width()/from_fract.width(),
+		to_fract.height()/from_fract.height(),
+		iter_max
+	);
+}
+
+Reprojection FRACTAL::Reprojection::map(
+	const CS<int> &scr,
+	const std::vector<int> &from,
+	const int from_iter_max,
+	const DeepCS &from_fract,
+	const DeepCS &to_fract,
+	const int iter_max
+)
+{
+	const double sx = from_fract.width/scr.width();
+	const double sy = from_fract.height/scr.height();
+	return map(
+		scr,
+		from,
+		from_iter_max,
+		(to_fract.x_min - from_fract.x_min).toDouble()/sx,
+		(to_fract.y_min - from_fract.y_min).toDouble()/sy,
+		to_fract.width/from_fract.width,
+		to_fract.height/from_fract.height,
+		iter_max
+	);
+}
+
+std::vector<double> FRACTAL::Reprojection::cost(
+	const CS<int> &scr,
+	const std::vector<cv::Rect> &tiles
+) const
+{
+	const int width = scr.width();
+	std::vector<double> out(tiles.size(), 0.0);
+	for(size_t t = 0; t < tiles.size(); ++t)
+	{
+		const auto& tile = tiles[t];
+		double sum = 0.0;
+		for(int y = tile.y; y < tile.y + tile.height; ++y)
+		{
+			for(int x = tile.x; x < tile.x + tile.width; ++x)
+			{
+				const int p = y*width + x;
+				if(exact[p])
+					continue;
+				sum += counts[p] == NO_HINT ? iter_max : counts[p];
+			}
+		}
+		out[t] = sum;
+	}
+	return out;
+}
@@ -0,0 +1,85 @@
+#ifndef FRACT_REPROJECT_H
+#define FRACT_REPROJECT_H
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "fract.h"
+
+namespace FRACTAL
+{
+//! @brief the counts of the previous frame seen from the pixels of the next
+//
+//  A zoom step renders a sub-rectangle of the previous window. A new pixel
+//  whose sample point is one of the old ones (integer zoom ratios, aligned
+//  windows) takes the old count as it is; the others get the count of the
+//  nearest old sample as a hint, used to predict the cost of the tiles,
+//  and a side: a pixel whose four old samples around it all escaped is
+//  taken as exterior and iterated without the interior checks, which
+//  only cost an escaping orbit time. A hint never decides a count.
+struct Reprojection
+{
+    enum Side
+    {
+        UNKNOWN = 0,
+        //! @brief the old samples around the pixel all escaped
+        EXTERIOR = 1,
+        //! @brief they all reached the old iter_max
+        INTERIOR = 2
+    };
+    //! @brief per pixel of the new frame: the count if exact, else the
+    //         hint, NO_HINT outside the old window; the side of the
+    //         pixels that are not exact
+    std::vector<int> counts;
+    std::vector<uint8_t> exact;
+    std::vector<uint8_t> side;
+    size_t exact_count = 0;
+    //! @brief of the new frame
+    int iter_max = 0;
+    static constexpr int NO_HINT = -1;
+
+    //! @brief pixel (x, y) of the new frame samples the old pixel
+    //         (off_x + x*scale_x, off_y + y*scale_y); both frames are scr
+    static Reprojection map(
+        const CS<int> &scr,
+        const std::vector<int> &from,
+        const int from_iter_max,
+        const double off_x,
+        const double off_y,
+        const double scale_x,
+        const double scale_y,
+        const int iter_max
+    );
+
+    //! @brief same, the windows given in the complex plane
+    static Reprojection map(
+        const CS<int> &scr,
+        const std::vector<int> &from,
+        const int from_iter_max,
+        const CS<double> &from_fract,
+        const CS<double> &to_fract,
+        const int iter_max
+    );
+
+    //! @brief same for deep windows, the offset is taken in BigFixed
+    static Reprojection map(
+        const CS<int> &scr,
+        const std::vector<int> &from,
+        const int from_iter_max,
+        const DeepCS &from_fract,
+        const DeepCS &to_fract,
+        const int iter_max
+    );
+
+    //! @brief predicted iterations of every tile: the hints of the pixels
+    //         still to compute, iter_max where there is none
+    std::vector<double> cost(
+        const CS<int> &scr,
+        const std::vector<cv::Rect> &tiles
+    ) const;
+};
+} // namespace FRACTAL
+
+#endif // FRACT_REPROJECT_H
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+#include "scheduler.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+namespace
+{
+//! @brief tiles of one thread; tiles are coarse, a mutex is cheap enough
+struct TileQueue
+{
+	std::mutex lock;
+	std::deque<int> tiles;
+
+	bool pop(int& t)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if(tiles.empty())
+			return false;
+		t = tiles.front();
+		tiles.pop_front();
+		return true;
+	}
+
+	bool steal(int& t)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if(tiles.empty())
+			return false;
+		t = tiles.back();
+		tiles.pop_back();
+		return true;
+	}
+
+	size_t size()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		return tiles.size();
+	}
+};
+
+double msSince(const std::chrono::steady_clock::time_point& start)
+{
+	return std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start
+	).count();
+}
+} // namespace
+
+std::string FRACTAL::Scheduler::Stats::info() const
+{
+	return cv::format(
+		"Scheduler::threads %d tiles %zu steals %zu total %.1f ms max tile %.1f ms imbalance %.2f%s",
+		threads,
+		tiles,
+		steals,
+		total_ms,
+		max_tile_ms,
+		imbalance,
+		cancelled ? " cancelled" : ""
+	);
+}
+
+std::vector<cv::Rect> FRACTAL::Scheduler::tiles(const cv::Rect& rc, const int size)
+{
+	const int step = std::max(size, 1);
+	std::vector<cv::Rect> out;
+	for(int y = rc.y; y < rc.y + rc.height; y += step)
+	{
+		for(int x = rc.x; x < rc.x + rc.width; x += step)
+		{
+			out.push_back(cv::Rect(
+				x,
+				y,
+				std::min(step, rc.x + rc.width - x),
+				std::min(step, rc.y + rc.height - y)
+			));
+		}
+	}
+	return out;
+}
+
+int FRACTAL::Scheduler::threads(const int requested)
+{
+	if(requested > 0)
+		return requested;
+	return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+FRACTAL::Scheduler::Stats FRACTAL::Scheduler::run(
+	const std::vector<cv::Rect>& tiles,
+	const std::vector<double>& cost,
+	const TileWork& work,
+	const int requested,
+	const CancelToken* cancel
+)
+{
+	auto start = std::chrono::steady_clock::now();
+	Stats stats;
+	stats.tiles = tiles.size();
+	stats.threads = std::min<int>(threads(requested), std::max<size_t>(tiles.size(), 1));
+
+	std::vector<int> order(tiles.size());
+	std::iota(order.begin(), order.end(), 0);
+	if(cost.size() == tiles.size())
+	{
+		std::stable_sort(
+			order.begin(),
+			order.end(),
+			[&cost](const int a, const int b) { return cost[a] > cost[b]; }
+		);
+	}
+	std::vector<TileQueue> queues(stats.threads);
+	for(size_t k = 0; k < order.size(); ++k)
+		queues[k % stats.threads].tiles.push_back(order[k]);
+
+	std::atomic<size_t> steals(0);
+	std::vector<double> max_tile(stats.threads, 0.0), busy(stats.threads, 0.0);
+	auto worker = [&](const int id) -> void
+	{
+		int t = 0;
+		for(;;)
+		{
+			if(cancel && cancel->cancelled())
+				return;
+			if(!queues[id].pop(t))
+			{
+				// steal from the queue with the most tiles left
+				int victim = -1;
+				size_t most = 0;
+				for(int q = 0; q < stats.threads; ++q)
+				{
+					const size_t n = q == id ? 0 : queues[q].size();
+					if(n > most)
+					{
+						most = n;
+						victim = q;
+					}
+				}
+				if(victim < 0)
+					return;
+				if(!queues[victim].steal(t))
+					continue;
+				++steals;
+			}
+			auto tile_start = std::chrono::steady_clock::now();
+			work(tiles[t], t);
+			const double ms = msSince(tile_start);
+			max_tile[id] = std::max(max_tile[id], ms);
+			busy[id] += ms;
+		}
+	};
+	std::vector<std::thread> pool;
+	for(int id = 1; id < stats.threads; ++id)
+		pool.emplace_back(worker, id);
+	worker(0);
+	for(auto& th : pool)
+		th.join();
+
+	stats.steals = steals;
+	stats.max_tile_ms = *std::max_element(max_tile.begin(), max_tile.end());
+	const double busy_mean = std::accumulate(busy.begin(), busy.end(), 0.0)/stats.threads;
+	if(busy_mean > 0.0)
+		stats.imbalance = *std::max_element(busy.begin(), busy.end())/busy_mean;
+	stats.total_ms = msSince(start);
+	stats.cancelled = cancel && cancel->cancelled();
+	return stats;
+}
@@ -0,0 +1,73 @@
+#ifndef FRACT_SCHEDULER_H
+#define FRACT_SCHEDULER_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace FRACTAL
+{
+//! @brief cooperative cancellation of a render: the owner cancels, the
+//         scheduler stops handing out tiles; a started tile runs to its
+//         end, so a render stops within one tile per thread
+class CancelToken
+{
+public:
+    void cancel() { _cancelled.store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return _cancelled.load(std::memory_order_relaxed); }
+private:
+    std::atomic<bool> _cancelled{false};
+};
+
+//! @brief tile scheduler for the render paths
+//
+//  Escape-time cost is very uneven: a tile on the set boundary can cost a
+//  thousand times an exterior one. Tiles are sorted by estimated cost and
+//  dealt round-robin to one deque per thread, the most expensive first.
+//  A thread pops from the front of its own deque and, once it runs dry,
+//  steals from the back of the fullest other deque, so a few heavy tiles
+//  never leave the other cores idle.
+struct Scheduler
+{
+    //! @brief work on tiles[index]
+    typedef std::function<void(const cv::Rect& tile, const size_t index)> TileWork;
+
+    struct Stats
+    {
+        int threads = 0;
+        size_t tiles = 0;
+        size_t steals = 0;
+        //! @brief wall time of the whole run and of its slowest tile
+        double total_ms = 0.0;
+        double max_tile_ms = 0.0;
+        //! @brief busiest thread's time in tiles over the mean of all
+        //         threads, 1 = perfectly even
+        double imbalance = 1.0;
+        //! @brief stopped by the cancel token before all tiles ran
+        bool cancelled = false;
+        std::string info() const;
+    };
+
+    //! @brief tiles of at most size x size covering rc, row by row
+    static std::vector<cv::Rect> tiles(const cv::Rect& rc, const int size);
+
+    //! @brief worker threads used for a request, 0 = all cores
+    static int threads(const int requested);
+
+    //! @brief run work once for every tile; cost[k] estimates tiles[k],
+    //         an empty cost keeps the given order; no more tiles start
+    //         once cancel is set
+    static Stats run(
+        const std::vector<cv::Rect>& tiles,
+        const std::vector<double>& cost,
+        const TileWork& work,
+        const int threads = 0,
+        const CancelToken* cancel = nullptr
+    );
+};
+} // namespace FRACTAL
+
+#endif // FRACT_SCHEDULER_H
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "subdivide.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+namespace
+{
+//! @brief inclusive rectangle [x0, x1] x [y0, y1] of lattice points
+struct Box
+{
+	int x0, y0, x1, y1;
+};
+
+//! @brief recursion state of one tile; tiles own disjoint pixels.
+//         Works on the points of the tile a stride apart: point (i, j)
+//         is the pixel (tile.x + i*stride, tile.y + j*stride)
+struct Subdivider
+{
+	Subdivider(
+		const Subdivision::PixelEval& eval_,
+		const int width_,
+		int* colors_,
+		const cv::Rect& tile_,
+		const int min_size_,
+		const int stride_
+	)
+	: eval(eval_)
+	, width(width_)
+	, colors(colors_)
+	, tile(tile_)
+	, stride(stride_)
+	, cols((tile_.width + stride_ - 1)/stride_)
+	, rows((tile_.height + stride_ - 1)/stride_)
+	, done(cols*rows, 0)
+	, min_size(std::max(min_size_, 2))
+	{}
+
+	const Subdivision::PixelEval& eval;
+	const int width;
+	int* colors;
+	const cv::Rect tile;
+	const int stride, cols, rows;
+	//! @brief points of the tile already evaluated or filled
+	std::vector<uint8_t> done;
+	const int min_size;
+	size_t evaluated = 0;
+	std::vector<int> xs, ys, out;
+
+	int& color(const int i, const int j)
+	{
+		return colors[(tile.y + j*stride)*width + tile.x + i*stride];
+	}
+
+	//! @brief queue the points of [i0, i1] x [j0, j1] not known yet
+	void add(const int i0, const int j0, const int i1, const int j1)
+	{
+		for(int j = j0; j <= j1; ++j)
+		{
+			for(int i = i0; i <= i1; ++i)
+			{
+				if(done[j*cols + i])
+					continue;
+				done[j*cols + i] = 1;
+				xs.push_back(tile.x + i*stride);
+				ys.push_back(tile.y + j*stride);
+			}
+		}
+	}
+
+	//! @brief evaluate the queued pixels in one call
+	void flush()
+	{
+		const int n = static_cast<int>(xs.size());
+		if(n == 0)
+			return;
+		out.resize(n);
+		eval(xs.data(), ys.data(), n, out.data());
+		for(int k = 0; k < n; ++k)
+			colors[ys[k]*width + xs[k]] = out[k];
+		evaluated += n;
+		xs.clear();
+		ys.clear();
+	}
+
+	bool uniformBorder(const Box& r)
+	{
+		const int v = color(r.x0, r.y0);
+		if(v < 0)
+			return false;
+		for(int i = r.x0; i <= r.x1; ++i)
+			if(color(i, r.y0) != v || color(i, r.y1) != v)
+				return false;
+		for(int j = r.y0 + 1; j < r.y1; ++j)
+			if(color(r.x0, j) != v || color(r.x1, j) != v)
+				return false;
+		return true;
+	}
+
+	//! @brief subdivide the whole tile; a level of the recursion at a time
+	//         so that every eval call gets the borders of all rectangles
+	//         of the level
+	void run()
+	{
+		std::vector<Box> level{Box{0, 0, cols - 1, rows - 1}}, next;
+		while(!level.empty())
+		{
+			for(const auto& r : level)
+			{
+				if(r.x1 - r.x0 < min_size || r.y1 - r.y0 < min_size)
+				{
+					add(r.x0, r.y0, r.x1, r.y1);
+					continue;
+				}
+				add(r.x0, r.y0, r.x1, r.y0);
+				add(r.x0, r.y1, r.x1, r.y1);
+				add(r.x0, r.y0 + 1, r.x0, r.y1 - 1);
+				add(r.x1, r.y0 + 1, r.x1, r.y1 - 1);
+			}
+			flush();
+			next.clear();
+			for(const auto& r : level)
+			{
+				if(r.x1 - r.x0 < min_size || r.y1 - r.y0 < min_size)
+					continue;
+				if(uniformBorder(r))
+				{
+					const int v = color(r.x0, r.y0);
+					for(int j = r.y0 + 1; j < r.y1; ++j)
+					{
+						for(int i = r.x0 + 1; i < r.x1; ++i)
+						{
+							color(i, j) = v;
+							done[j*cols + i] = 1;
+						}
+					}
+					continue;
+				}
+				const int xm = (r.x0 + r.x1)/2, ym = (r.y0 + r.y1)/2;
+				next.push_back(Box{r.x0, r.y0, xm, ym});
+				next.push_back(Box{xm, r.y0, r.x1, ym});
+				next.push_back(Box{r.x0, ym, xm, r.y1});
+				next.push_back(Box{xm, ym, r.x1, r.y1});
+			}
+			level.swap(next);
+		}
+	}
+};
+} // namespace
+
+size_t FRACTAL::Subdivision::render(
+	const CS<int> &scr,
+	std::vector<int> &colors,
+	const PixelEval &eval,
+	const cv::Rect &rc,
+	const int min_size,
+	const int stride
+)
+{
+	if(rc.empty())
+		return 0;
+	Subdivider sub(eval, scr.width(), colors.data(), rc, min_size, std::max(stride, 1));
+	sub.run();
+	return sub.evaluated;
+}
+
+size_t FRACTAL::Subdivision::brute(
+	const CS<int> &scr,
+	std::vector<int> &colors,
+	const PixelEval &eval,
+	const cv::Rect &rc,
+	const int stride
+)
+{
+	const int width = scr.width(), step = std::max(stride, 1);
+	std::vector<int> xs, ys, out;
+	for(int x = rc.x; x < rc.x + rc.width; x += step)
+		xs.push_back(x);
+	const int n = static_cast<int>(xs.size());
+	ys.resize(n);
+	out.resize(n);
+	for(int y = rc.y; y < rc.y + rc.height; y += step)
+	{
+		std::fill(ys.begin(), ys.end(), y);
+		if(step == 1)
+		{
+			eval(xs.data(), ys.data(), n, &colors[y*width + rc.x]);
+			continue;
+		}
+		eval(xs.data(), ys.data(), n, out.data());
+		for(int k = 0; k < n; ++k)
+			colors[y*width + xs[k]] = out[k];
+	}
+	return static_cast<size_t>(n)*((rc.height + step - 1)/step);
+}
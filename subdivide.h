@@ -0,0 +1,48 @@
+#ifndef FRACT_SUBDIVIDE_H
+#define FRACT_SUBDIVIDE_H
+
+#include <vector>
+
+#include "fract.h"
+
+namespace FRACTAL
+{
+//! @brief Mariani-Silver rectangle subdivision of one tile of the screen
+//
+//  The set and its escape-time bands are connected, so a rectangle whose
+//  border has one count everywhere holds that count inside as well. The
+//  border is traced, uniform rectangles are filled, the others are split
+//  in four and traced again, down to min_size where every pixel is
+//  evaluated. Borders shared by neighbours are evaluated once, and each
+//  border goes to eval in one call so vector kernels keep their lanes full.
+struct Subdivision
+{
+    typedef Fract::PixelEval PixelEval;
+
+    //! @brief fill the pixels of rc, rows of colors are scr.width() long;
+    //         negative counts are never taken as uniform (pending pixels
+    //         of the perturbation pass); returns the number of pixels
+    //         actually evaluated. With stride > 1 only the pixels at
+    //         multiples of stride from the corner of rc are filled, as a
+    //         coarse image of rc
+    static size_t render(
+        const CS<int> &scr,
+        std::vector<int> &colors,
+        const PixelEval &eval,
+        const cv::Rect &rc,
+        const int min_size = 4,
+        const int stride = 1
+    );
+
+    //! @brief every pixel of rc (every stride-th) through eval, a row per call
+    static size_t brute(
+        const CS<int> &scr,
+        std::vector<int> &colors,
+        const PixelEval &eval,
+        const cv::Rect &rc,
+        const int stride = 1
+    );
+};
+} // namespace FRACTAL
+
+#endif // FRACT_SUBDIVIDE_H
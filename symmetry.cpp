@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include "symmetry.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+namespace
+{
+//! @brief pixels off the exact axis that still count as on it
+const double AXIS_TOL = 1e-6;
+
+//! @brief twice the axis coordinate if it falls on a pixel or half way
+//         between two
+bool twice(const double axis, int& out)
+{
+	const double t = 2.0*axis, r = std::round(t);
+	if(!std::isfinite(t) || std::fabs(t - r) > 2.0*AXIS_TOL
+		|| std::fabs(r) > INT_MAX/2)
+		return false;
+	out = static_cast<int>(r);
+	return true;
+}
+
+//! @brief floor(s/2), the last pixel before the axis or on it
+int floorHalf(const int s)
+{
+	return s >= 0 ? s/2 : -((1 - s)/2);
+}
+
+template <typename V>
+void copyMirrored(
+	const Symmetry& symmetry,
+	std::vector<V>& values,
+	const int width,
+	const cv::Rect& mirrored
+)
+{
+	for(int y = mirrored.y; y < mirrored.y + mirrored.height; ++y)
+	{
+		const V* src = &values[(symmetry.sy - y)*width];
+		V* dst = &values[y*width];
+		if(symmetry.kind == Symmetry::CONJUGATE)
+			std::copy_n(src + mirrored.x, mirrored.width, dst + mirrored.x);
+		else
+		{
+			for(int x = mirrored.x; x < mirrored.x + mirrored.width; ++x)
+				dst[x] = src[symmetry.sx - x];
+		}
+	}
+}
+} // namespace
+
+Symmetry FRACTAL::Symmetry::conjugate(const double axis_y)
+{
+	Symmetry s;
+	if(twice(axis_y, s.sy))
+		s.kind = CONJUGATE;
+	return s;
+}
+
+Symmetry FRACTAL::Symmetry::point(const double axis_x, const double axis_y)
+{
+	Symmetry s;
+	if(twice(axis_x, s.sx) && twice(axis_y, s.sy))
+		s.kind = POINT;
+	return s;
+}
+
+cv::Rect FRACTAL::Symmetry::mirrored(const cv::Rect& rc) const
+{
+	if(kind == NONE || rc.empty())
+		return cv::Rect();
+	// rows past the axis whose mirror row sy - y is still in rc
+	const int y0 = std::max(rc.y, floorHalf(sy) + 1);
+	const int y1 = std::min(rc.y + rc.height, sy - rc.y + 1);
+	int x0 = rc.x, x1 = rc.x + rc.width;
+	if(kind == POINT)
+	{
+		x0 = std::max(x0, sx - (rc.x + rc.width - 1));
+		x1 = std::min(x1, sx - rc.x + 1);
+	}
+	if(y1 <= y0 || x1 <= x0)
+		return cv::Rect();
+	return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+std::vector<cv::Rect> FRACTAL::Symmetry::subtract(
+	const std::vector<cv::Rect>& tiles,
+	const cv::Rect& cut
+)
+{
+	if(cut.empty())
+		return tiles;
+	std::vector<cv::Rect> out;
+	out.reserve(tiles.size());
+	for(const auto& t : tiles)
+	{
+		const cv::Rect i = t & cut;
+		if(i.empty())
+		{
+			out.push_back(t);
+			continue;
+		}
+		// above and below the cut across the tile, left and right beside it
+		const cv::Rect pieces[4] = {
+			cv::Rect(t.x, t.y, t.width, i.y - t.y),
+			cv::Rect(t.x, i.y + i.height, t.width, t.y + t.height - i.y - i.height),
+			cv::Rect(t.x, i.y, i.x - t.x, i.height),
+			cv::Rect(i.x + i.width, i.y, t.x + t.width - i.x - i.width, i.height)
+		};
+		for(const auto& p : pieces)
+		{
+			if(!p.empty())
+				out.push_back(p);
+		}
+	}
+	return out;
+}
+
+void FRACTAL::Symmetry::copy(
+	std::vector<int>& colors,
+	const int width,
+	const cv::Rect& mirrored
+) const
+{
+	copyMirrored(*this, colors, width, mirrored);
+}
+
+void FRACTAL::Symmetry::copy(
+	std::vector<float>& values,
+	const int width,
+	const cv::Rect& mirrored
+) const
+{
+	copyMirrored(*this, values, width, mirrored);
+}
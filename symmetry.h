@@ -0,0 +1,64 @@
+#ifndef FRACT_SYMMETRY_H
+#define FRACT_SYMMETRY_H
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "formula.h"
+
+namespace FRACTAL
+{
+//! @brief mirrored pixels of a frame, copied instead of iterated
+//
+//  A formula with conj(f(z, c)) = f(conj(z), conj(c)) gives the Mandelbrot
+//  set of conj(c) the orbit of c mirrored, so the rows below the real axis
+//  repeat the rows above. One with f(-z) = f(z) gives every Julia set the
+//  same orbit for z0 and -z0, the frame is point symmetric about 0. Only
+//  a window whose axis falls on a pixel row (column) or half way between
+//  two has pixels with an exact mirror; the others render as they are.
+struct Symmetry
+{
+    enum Kind
+    {
+        NONE = 0,
+        //! @brief (x, y) mirrors (x, sy - y)
+        CONJUGATE = 1,
+        //! @brief (x, y) mirrors (sx - x, sy - y)
+        POINT = 2
+    };
+    Kind kind = NONE;
+    //! @brief twice the pixel coordinates of c = 0 (z0 = 0)
+    int sx = 0, sy = 0;
+
+    //! @brief axis_x, axis_y: pixel coordinates of 0 in the frame
+    static Symmetry conjugate(const double axis_y);
+    static Symmetry point(const double axis_x, const double axis_y);
+    //! @brief the symmetry formula F promises, NONE for the others
+    template <typename F>
+    static Symmetry of(const double axis_x, const double axis_y)
+    {
+        if(F::point_symmetric)
+            return point(axis_x, axis_y);
+        if(F::conjugate_symmetric)
+            return conjugate(axis_y);
+        return Symmetry();
+    }
+
+    bool none() const { return kind == NONE; }
+    //! @brief the pixels of rc past the axis whose mirror is in rc too,
+    //         empty if none
+    cv::Rect mirrored(const cv::Rect& rc) const;
+    //! @brief tiles with the rectangle cut out, up to four pieces each
+    static std::vector<cv::Rect> subtract(
+        const std::vector<cv::Rect>& tiles,
+        const cv::Rect& cut
+    );
+    //! @brief colors of the pixels of mirrored from their mirror, rows of
+    //         width pixels
+    void copy(std::vector<int>& colors, const int width, const cv::Rect& mirrored) const;
+    void copy(std::vector<float>& values, const int width, const cv::Rect& mirrored) const;
+};
+} // namespace FRACTAL
+
+#endif // FRACT_SYMMETRY_H
@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#ifndef _WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "compactcounts.h"
+#include "tilecache.h"
+#include "tools.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+namespace
+{
+//! @brief tile file: magic, side, iter_max, level, then the packed tile
+const int32_t TILE_MAGIC = 0x5a4c5446; // "FTLZ"
+const int TILE_HEADER = 4;
+
+//! @brief grid indices of the corner must stay exact in double
+const int64_t MAX_INDEX = int64_t(1) << 52;
+
+int64_t floorDiv(const int64_t a, const int64_t b)
+{
+	return a >= 0 ? a/b : -((-a + b - 1)/b);
+}
+} // namespace
+
+bool FRACTAL::TileCache::Key::operator==(const Key& other) const
+{
+	return level == other.level && tx == other.tx && ty == other.ty
+		&& iter_max == other.iter_max && formula == other.formula;
+}
+
+size_t FRACTAL::TileCache::KeyHash::operator()(const Key& key) const
+{
+	size_t h = std::hash<int64_t>()(key.tx);
+	h = h*1000003u ^ std::hash<int64_t>()(key.ty);
+	h = h*1000003u ^ std::hash<int>()(key.level);
+	h = h*1000003u ^ std::hash<int>()(key.iter_max);
+	return h*1000003u ^ std::hash<int>()(key.formula);
+}
+
+FRACTAL::TileCache::TileCache(
+	const int side,
+	const size_t max_tiles,
+	const std::string& dir
+)
+: _side(side)
+, _max_tiles(std::max<size_t>(max_tiles, 1))
+, _dir(dir)
+{
+	if(side < 1 || (side & (side - 1)) != 0)
+		throw std::runtime_error("TileCache: tile side must be a power of two");
+	if(!_dir.empty() && !FRACTAL::mkdir(_dir))
+		throw std::runtime_error("TileCache: cannot create " + _dir);
+}
+
+CS<double> FRACTAL::TileCache::snap(
+	const CS<int>& scr,
+	const double x1,
+	const double x2,
+	const double y1,
+	const double y2
+)
+{
+	const int width = scr.width(), height = scr.height();
+	const double step = std::exp2(std::round(std::log2((x2 - x1)/width)));
+	const double xc = 0.5*(x1 + x2), yc = 0.5*(y1 + y2);
+	const double x_min = std::round(xc/step - 0.5*width)*step;
+	const double y_min = std::round(yc/step - 0.5*height)*step;
+	return CS<double>(x_min, x_min + width*step, y_min, y_min + height*step);
+}
+
+bool FRACTAL::TileCache::aligned(
+	const CS<int>& scr,
+	const CS<double>& fract,
+	int& level,
+	int64_t& x0,
+	int64_t& y0
+) const
+{
+	const double step = fract.width()/scr.width();
+	if(!(step > 0.0) || step != fract.height()/scr.height())
+		return false;
+	int e = 0;
+	if(std::frexp(step, &e) != 0.5)
+		return false;
+	const double gx = fract.x_min()/step, gy = fract.y_min()/step;
+	if(gx != std::floor(gx) || gy != std::floor(gy)
+		|| std::fabs(gx) >= MAX_INDEX || std::fabs(gy) >= MAX_INDEX)
+		return false;
+	// step = 2^(e - 1) = 4/(side*2^level)
+	level = 2 - std::ilogb(static_cast<double>(_side)) - (e - 1);
+	x0 = static_cast<int64_t>(gx);
+	y0 = static_cast<int64_t>(gy);
+	return true;
+}
+
+bool FRACTAL::TileCache::render(
+	const CS<int>& scr,
+	const CS<double>& fract,
+	const int iter_max,
+	const int formula,
+	std::vector<int>& colors,
+	const PointEval& eval,
+	const RenderOptions& opts,
+	const Symmetry::Kind symmetry
+)
+{
+	int level = 0;
+	int64_t x0 = 0, y0 = 0;
+	if(!aligned(scr, fract, level, x0, y0))
+		return false;
+	const int width = scr.width(), height = scr.height(), side = _side;
+	const int64_t tx0 = floorDiv(x0, side), ty0 = floorDiv(y0, side);
+	const int cols = static_cast<int>(floorDiv(x0 + width - 1, side) - tx0 + 1);
+	const int rows = static_cast<int>(floorDiv(y0 + height - 1, side) - ty0 + 1);
+	// the frame grown to whole tiles, its corner at grid index (ex, ey)
+	const int ew = cols*side, eh = rows*side;
+	const int64_t ex = tx0*side, ey = ty0*side;
+	std::vector<int> ext(static_cast<size_t>(ew)*eh);
+	std::vector<cv::Rect> missing;
+	std::vector<Key> missing_keys;
+	for(int r = 0; r < rows; ++r)
+	{
+		for(int c = 0; c < cols; ++c)
+		{
+			const Key key{level, tx0 + c, ty0 + r, iter_max, formula};
+			const cv::Rect rc(c*side, r*side, side, side);
+			auto tile = get(key);
+			if(!tile || !CompactCounts::unpackTile(
+				tile->data(),
+				tile->size(),
+				side,
+				side,
+				&ext[rc.y*ew + rc.x],
+				ew
+			))
+			{
+				missing.push_back(rc);
+				missing_keys.push_back(key);
+			}
+		}
+	}
+	if(!missing.empty())
+	{
+		// grid points are exact in double, the same c for every frame
+		// that shares the tile
+		const double step = fract.width()/width;
+		std::vector<double> cx(ew), cy(eh);
+		for(int i = 0; i < ew; ++i)
+			cx[i] = static_cast<double>(ex + i)*step;
+		for(int j = 0; j < eh; ++j)
+			cy[j] = static_cast<double>(ey + j)*step;
+		CS<int> ext_scr(0, ew, 0, eh);
+		// 0 is at grid index 0, pixel -ex of the grown frame
+		Symmetry mirror;
+		if(symmetry == Symmetry::CONJUGATE)
+			mirror = Symmetry::conjugate(static_cast<double>(-ey));
+		else if(symmetry == Symmetry::POINT)
+			mirror = Symmetry::point(static_cast<double>(-ex), static_cast<double>(-ey));
+		const cv::Rect mirrored = mirror.mirrored(cv::Rect(0, 0, ew, eh));
+		std::vector<double> cost;
+		Fract::renderTiles(
+			ext_scr,
+			cv::Rect(0, 0, ew, eh),
+			Symmetry::subtract(missing, mirrored),
+			cost,
+			ext,
+			[&cx, &cy, &eval](const int* xs, const int* ys, int n, int* out) -> void
+			{
+				thread_local std::vector<double> pr, pi;
+				pr.resize(n);
+				pi.resize(n);
+				for(int k = 0; k < n; ++k)
+				{
+					pr[k] = cx[xs[k]];
+					pi[k] = cy[ys[k]];
+				}
+				eval(pr.data(), pi.data(), n, out);
+			},
+			opts
+		);
+		for(size_t t = 0; t < missing.size() && !opts.cancelled(); ++t)
+		{
+			const cv::Rect part = missing[t] & mirrored;
+			if(!part.empty())
+				mirror.copy(ext, ew, part);
+		}
+		// tiles of a cancelled render may be half done
+		for(size_t t = 0; t < missing.size() && !opts.cancelled(); ++t)
+		{
+			const auto& rc = missing[t];
+			auto tile = std::make_shared<Packed>();
+			CompactCounts::packTile(&ext[rc.y*ew + rc.x], side, side, ew, *tile);
+			tile->shrink_to_fit();
+			put(missing_keys[t], tile);
+		}
+	}
+	colors.resize(static_cast<size_t>(width)*height);
+	const int ox = static_cast<int>(x0 - ex), oy = static_cast<int>(y0 - ey);
+	for(int y = 0; y < height; ++y)
+		std::copy_n(&ext[(oy + y)*ew + ox], width, &colors[y*width]);
+	cout << cv::format(
+		"TileCache::level %d, %d/%d tiles cached, %.1f MB held",
+		level,
+		cols*rows - static_cast<int>(missing.size()),
+		cols*rows,
+		bytes()/1048576.0
+	) << endl;
+	return true;
+}
+
+std::shared_ptr<const TileCache::Packed> FRACTAL::TileCache::get(const Key& key)
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		auto it = _index.find(key);
+		if(it != _index.end())
+		{
+			_lru.splice(_lru.begin(), _lru, it->second);
+			return it->second->second;
+		}
+	}
+	if(_dir.empty())
+		return nullptr;
+	auto tile = load(key);
+	if(tile)
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		insert(key, tile);
+	}
+	return tile;
+}
+
+void FRACTAL::TileCache::put(const Key& key, const std::shared_ptr<const Packed>& tile)
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		insert(key, tile);
+	}
+	if(!_dir.empty())
+		store(key, *tile);
+}
+
+size_t FRACTAL::TileCache::size() const
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _lru.size();
+}
+
+size_t FRACTAL::TileCache::bytes() const
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _bytes;
+}
+
+void FRACTAL::TileCache::insert(const Key& key, const std::shared_ptr<const Packed>& tile)
+{
+	auto it = _index.find(key);
+	if(it != _index.end())
+	{
+		_bytes += tile->size();
+		_bytes -= it->second->second->size();
+		it->second->second = tile;
+		_lru.splice(_lru.begin(), _lru, it->second);
+		return;
+	}
+	_lru.emplace_front(key, tile);
+	_index[key] = _lru.begin();
+	_bytes += tile->size();
+	while(_lru.size() > _max_tiles)
+	{
+		_bytes -= _lru.back().second->size();
+		_index.erase(_lru.back().first);
+		_lru.pop_back();
+	}
+}
+
+std::string FRACTAL::TileCache::path(const Key& key) const
+{
+	return join(_dir, cv::format(
+		"f%d_i%d_l%d_%lld_%lld.tile",
+		key.formula,
+		key.iter_max,
+		key.level,
+		static_cast<long long>(key.tx),
+		static_cast<long long>(key.ty)
+	));
+}
+
+std::shared_ptr<const TileCache::Packed> FRACTAL::TileCache::load(const Key& key) const
+{
+	const size_t header = TILE_HEADER*sizeof(int32_t);
+	auto tile = std::make_shared<Packed>();
+	const auto file = path(key);
+#ifndef _WINDOWS
+	const int fd = ::open(file.c_str(), O_RDONLY);
+	if(fd < 0)
+		return nullptr;
+	struct stat st;
+	if(::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) <= header)
+	{
+		::close(fd);
+		return nullptr;
+	}
+	const size_t bytes = static_cast<size_t>(st.st_size);
+	void* map = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(map == MAP_FAILED)
+		return nullptr;
+	const int32_t* data = static_cast<const int32_t*>(map);
+	const bool valid = data[0] == TILE_MAGIC && data[1] == _side
+		&& data[2] == key.iter_max && data[3] == key.level;
+	if(valid)
+	{
+		const uint8_t* packed = static_cast<const uint8_t*>(map) + header;
+		tile->assign(packed, packed + (bytes - header));
+	}
+	::munmap(map, bytes);
+#else
+	std::ifstream f(file, std::ios::binary | std::ios::ate);
+	if(!f)
+		return nullptr;
+	const size_t bytes = static_cast<size_t>(f.tellg());
+	if(bytes <= header)
+		return nullptr;
+	f.seekg(0);
+	int32_t data[TILE_HEADER];
+	f.read(reinterpret_cast<char*>(data), header);
+	tile->resize(bytes - header);
+	f.read(reinterpret_cast<char*>(tile->data()), tile->size());
+	const bool valid = f.gcount() == static_cast<std::streamsize>(tile->size())
+		&& data[0] == TILE_MAGIC && data[1] == _side
+		&& data[2] == key.iter_max && data[3] == key.level;
+#endif
+	return valid ? tile : nullptr;
+}
+
+void FRACTAL::TileCache::store(const Key& key, const Packed& tile) const
+{
+	const auto file = path(key);
+	if(isFileExist(file))
+		return;
+	// written aside and renamed so a reader never maps half a tile
+	const auto tmp = file + ".tmp";
+	{
+		std::ofstream f(tmp, std::ios::binary);
+		const int32_t header[TILE_HEADER] = {TILE_MAGIC, _side, key.iter_max, key.level};
+		f.write(reinterpret_cast<const char*>(header), sizeof(header));
+		f.write(reinterpret_cast<const char*>(tile.data()), tile.size());
+		if(!f)
+		{
+			cout << "TileCache::cannot write " << tmp << endl;
+			return;
+		}
+	}
+	std::rename(tmp.c_str(), file.c_str());
+}
@@ -0,0 +1,121 @@
+#ifndef FRACT_TILECACHE_H
+#define FRACT_TILECACHE_H
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fract.h"
+
+namespace FRACTAL
+{
+//! @brief escape counts kept per quadtree tile of the complex plane
+//
+//  Level l samples the plane on the grid of step 4/(side*2^l), a power of
+//  two, and cuts it into tiles of side x side samples: tile (tx, ty) holds
+//  the points ((tx*side + i)*step, (ty*side + j)*step). A frame whose
+//  window lies on the grid of some level (snap()) is put together from
+//  the cached tiles it overlaps; only the missing ones are rendered, in
+//  full, and kept. Tiles are kept packed (CompactCounts::packTile), in
+//  an LRU list in memory and, optionally, as files under a directory that
+//  are mapped back on a miss.
+class TileCache
+{
+public:
+    struct Key
+    {
+        int level;
+        int64_t tx, ty;
+        int iter_max;
+        //! @brief formula::*::id
+        int formula;
+        bool operator==(const Key& other) const;
+    };
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+    //! @brief side x side counts, CompactCounts::packTile
+    typedef std::vector<uint8_t> Packed;
+    //! @brief counts of the points c = (cr[k], ci[k]), k in [0, n)
+    typedef std::function<void(const double* cr, const double* ci, int n, int* out)> PointEval;
+
+    //! @brief side: samples per tile edge, a power of two; max_tiles in
+    //         memory; no disk tier with an empty dir
+    explicit TileCache(
+        const int side = 64,
+        const size_t max_tiles = 2048,
+        const std::string& dir = ""
+    );
+
+    int side() const { return _side; }
+    const std::string& dir() const { return _dir; }
+
+    //! @brief the window on the grid closest to [x1, x2] x [y1, ...]:
+    //         grid step nearest to (x2 - x1)/scr.width() in log scale,
+    //         same center, scr.width() x scr.height() samples
+    static CS<double> snap(
+        const CS<int>& scr,
+        const double x1,
+        const double x2,
+        const double y1,
+        const double y2
+    );
+
+    //! @brief the level and the grid index of the corner of fract, false
+    //         if its samples are not grid points of any level
+    bool aligned(
+        const CS<int>& scr,
+        const CS<double>& fract,
+        int& level,
+        int64_t& x0,
+        int64_t& y0
+    ) const;
+
+    //! @brief fill colors of an aligned window from the cache, rendering
+    //         the missing tiles through eval (Fract::renderTiles, opts),
+    //         their pixels mirrored by the formula's symmetry copied;
+    //         false, colors untouched, if fract is not aligned
+    bool render(
+        const CS<int>& scr,
+        const CS<double>& fract,
+        const int iter_max,
+        const int formula,
+        std::vector<int>& colors,
+        const PointEval& eval,
+        const RenderOptions& opts,
+        const Symmetry::Kind symmetry = Symmetry::NONE
+    );
+
+    std::shared_ptr<const Packed> get(const Key& key);
+    void put(const Key& key, const std::shared_ptr<const Packed>& tile);
+
+    size_t size() const;
+    //! @brief packed bytes held in memory
+    size_t bytes() const;
+
+private:
+    typedef std::pair<Key, std::shared_ptr<const Packed>> Entry;
+
+    std::string path(const Key& key) const;
+    std::shared_ptr<const Packed> load(const Key& key) const;
+    void store(const Key& key, const Packed& tile) const;
+    //! @brief insert at the front, evict from the back; caller holds _lock
+    void insert(const Key& key, const std::shared_ptr<const Packed>& tile);
+
+    int _side;
+    size_t _max_tiles;
+    std::string _dir;
+    size_t _bytes = 0;
+    mutable std::mutex _lock;
+    std::list<Entry> _lru;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> _index;
+};
+} // namespace FRACTAL
+
+#endif // FRACT_TILECACHE_H
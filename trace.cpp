@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "trace.h"
+
+using namespace std;
+using namespace FRACTAL;
+
+namespace
+{
+struct Event
+{
+	const char* name;
+	int64_t start_ns;
+	int64_t dur_ns;
+	const char* arg_names[2];
+	double args[2];
+};
+
+//! @brief spans of one thread at a time; its lock is only contended while
+//         the trace is written or summed up
+struct Ring
+{
+	int lane = 0;
+	std::mutex lock;
+	std::vector<Event> events;
+	size_t capacity = 0;
+	size_t next = 0;
+	size_t overwritten = 0;
+
+	void push(const Event& e)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if(events.size() < capacity)
+			events.push_back(e);
+		else
+		{
+			events[next] = e;
+			++overwritten;
+		}
+		next = (next + 1) % capacity;
+	}
+
+	//! @brief oldest first
+	void copyTo(std::vector<std::pair<int, Event>>& out)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		const size_t first = events.size() < capacity ? 0 : next;
+		for(size_t k = 0; k < events.size(); ++k)
+			out.emplace_back(lane, events[(first + k) % events.size()]);
+	}
+};
+
+struct Registry
+{
+	std::mutex lock;
+	std::vector<std::unique_ptr<Ring>> rings;
+	std::vector<Ring*> free;
+	size_t ring_size = 1 << 16;
+	std::chrono::steady_clock::time_point zero;
+	bool started = false;
+};
+
+Registry& registry()
+{
+	static Registry r;
+	return r;
+}
+
+//! @brief the ring of this thread, back on the free list when it exits
+struct Lane
+{
+	Ring* ring = nullptr;
+
+	~Lane()
+	{
+		if(!ring)
+			return;
+		auto& r = registry();
+		std::lock_guard<std::mutex> guard(r.lock);
+		r.free.push_back(ring);
+	}
+
+	Ring& get()
+	{
+		if(ring)
+			return *ring;
+		auto& r = registry();
+		std::lock_guard<std::mutex> guard(r.lock);
+		if(r.free.empty())
+		{
+			r.rings.emplace_back(new Ring);
+			r.rings.back()->lane = static_cast<int>(r.rings.size()) - 1;
+			r.free.push_back(r.rings.back().get());
+		}
+		ring = r.free.back();
+		r.free.pop_back();
+		ring->capacity = r.ring_size;
+		return *ring;
+	}
+};
+
+thread_local Lane lane;
+
+std::vector<std::pair<int, Event>> collect(size_t& lanes, size_t& overwritten)
+{
+	std::vector<std::pair<int, Event>> out;
+	auto& r = registry();
+	std::lock_guard<std::mutex> guard(r.lock);
+	lanes = r.rings.size();
+	overwritten = 0;
+	for(auto& ring : r.rings)
+	{
+		ring->copyTo(out);
+		overwritten += ring->overwritten;
+	}
+	std::stable_sort(
+		out.begin(),
+		out.end(),
+		[](const std::pair<int, Event>& a, const std::pair<int, Event>& b)
+		{
+			return a.second.start_ns < b.second.start_ns;
+		}
+	);
+	return out;
+}
+} // namespace
+
+void FRACTAL::Trace::enable(const size_t ring_size)
+{
+	auto& r = registry();
+	{
+		std::lock_guard<std::mutex> guard(r.lock);
+		r.ring_size = std::max<size_t>(ring_size, 1);
+		if(!r.started)
+		{
+			r.zero = std::chrono::steady_clock::now();
+			r.started = true;
+		}
+	}
+	_enabled.store(true, std::memory_order_release);
+}
+
+void FRACTAL::Trace::disable()
+{
+	_enabled.store(false, std::memory_order_relaxed);
+}
+
+void FRACTAL::Trace::clear()
+{
+	auto& r = registry();
+	std::lock_guard<std::mutex> guard(r.lock);
+	for(auto& ring : r.rings)
+	{
+		std::lock_guard<std::mutex> ring_guard(ring->lock);
+		ring->events.clear();
+		ring->next = 0;
+		ring->overwritten = 0;
+	}
+}
+
+FRACTAL::Trace::Span::~Span()
+{
+	if(!_name)
+		return;
+	const auto end = std::chrono::steady_clock::now();
+	auto& r = registry();
+	Event e{
+		_name,
+		std::chrono::duration_cast<std::chrono::nanoseconds>(_start - r.zero).count(),
+		std::chrono::duration_cast<std::chrono::nanoseconds>(end - _start).count(),
+		{_arg_names[0], _arg_names[1]},
+		{_args[0], _args[1]}
+	};
+	lane.get().push(e);
+}
+
+FRACTAL::Trace::Span& FRACTAL::Trace::Span::arg(const char* name, const double value)
+{
+	if(!_name)
+		return *this;
+	const int k = _arg_names[0] && _arg_names[0] != name ? 1 : 0;
+	_arg_names[k] = name;
+	_args[k] = value;
+	return *this;
+}
+
+bool FRACTAL::Trace::write(const std::string& path)
+{
+	size_t lanes = 0, overwritten = 0;
+	const auto events = collect(lanes, overwritten);
+	std::ofstream f(path);
+	f << "{\"traceEvents\":[\n";
+	for(size_t l = 0; l < lanes; ++l)
+	{
+		f << cv::format(
+			"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"lane %zu\"}},\n",
+			l,
+			l
+		);
+	}
+	for(size_t k = 0; k < events.size(); ++k)
+	{
+		const auto& e = events[k].second;
+		f << cv::format(
+			"{\"name\":\"%s\",\"cat\":\"fractal\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+			e.name,
+			events[k].first,
+			e.start_ns*1e-3,
+			e.dur_ns*1e-3
+		);
+		if(e.arg_names[0])
+		{
+			f << ",\"args\":{" << cv::format("\"%s\":%.17g", e.arg_names[0], e.args[0]);
+			if(e.arg_names[1])
+				f << cv::format(",\"%s\":%.17g", e.arg_names[1], e.args[1]);
+			f << "}";
+		}
+		f << (k + 1 < events.size() ? "},\n" : "}\n");
+	}
+	f << "],\"displayTimeUnit\":\"ms\"}\n";
+	if(!f)
+	{
+		cout << "Trace::cannot write " << path << endl;
+		return false;
+	}
+	cout << cv::format(
+		"Trace::%zu spans on %zu lanes written to %s",
+		events.size(),
+		lanes,
+		path.c_str()
+	) << endl;
+	return true;
+}
+
+std::string FRACTAL::Trace::summary()
+{
+	struct Totals
+	{
+		size_t count = 0;
+		int64_t total_ns = 0;
+		int64_t max_ns = 0;
+		//! @brief sum and max of each argument
+		std::map<std::string, std::pair<double, double>> args;
+	};
+	size_t lanes = 0, overwritten = 0;
+	const auto events = collect(lanes, overwritten);
+	std::map<std::string, Totals> by_name;
+	for(const auto& le : events)
+	{
+		const auto& e = le.second;
+		auto& t = by_name[e.name];
+		++t.count;
+		t.total_ns += e.dur_ns;
+		t.max_ns = std::max(t.max_ns, e.dur_ns);
+		for(int a = 0; a < 2; ++a)
+		{
+			if(!e.arg_names[a])
+				continue;
+			auto it = t.args.find(e.arg_names[a]);
+			if(it == t.args.end())
+				t.args.emplace(e.arg_names[a], std::make_pair(e.args[a], e.args[a]));
+			else
+			{
+				it->second.first += e.args[a];
+				it->second.second = std::max(it->second.second, e.args[a]);
+			}
+		}
+	}
+	auto out = cv::format(
+		"Trace::%zu spans on %zu lanes, %zu overwritten",
+		events.size(),
+		lanes,
+		overwritten
+	);
+	for(const auto& nt : by_name)
+	{
+		const auto& t = nt.second;
+		out += cv::format(
+			"\n  %-10s n %6zu total %10.1f ms mean %8.3f ms max %8.3f ms",
+			nt.first.c_str(),
+			t.count,
+			t.total_ns*1e-6,
+			t.total_ns*1e-6/t.count,
+			t.max_ns*1e-6
+		);
+		for(const auto& a : t.args)
+			out += cv::format(
+				" %s sum %.4g max %.4g",
+				a.first.c_str(),
+				a.second.first,
+				a.second.second
+			);
+	}
+	return out;
+}
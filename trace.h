@@ -0,0 +1,64 @@
+#ifndef FRACT_TRACE_H
+#define FRACT_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace FRACTAL
+{
+//! @brief spans of the hot paths, for chrome://tracing or ui.perfetto.dev
+//
+//  Off by default; a disabled span costs one atomic load. Every thread
+//  records into a ring of its own, taken from a free list when it first
+//  records and given back when it exits, so the short-lived scheduler
+//  threads of every frame share a few rings (one lane each in the trace).
+//  A full ring overwrites its oldest spans. Span and argument names are
+//  kept by pointer and must be string literals.
+class Trace
+{
+public:
+    //! @brief start recording; the first call also sets time zero
+    static void enable(const size_t ring_size = 1 << 16);
+    static void disable();
+    static bool enabled() { return _enabled.load(std::memory_order_acquire); }
+    //! @brief drop every recorded span
+    static void clear();
+
+    //! @brief chrome trace_event json of the recorded spans
+    static bool write(const std::string& path);
+    //! @brief per span name: count, total, mean and max wall time, and the
+    //         sum and max of every argument
+    static std::string summary();
+
+    //! @brief times the scope it lives in, up to two numeric arguments
+    class Span
+    {
+    public:
+        explicit Span(const char* name)
+        : _name(enabled() ? name : nullptr)
+        {
+            if(_name)
+                _start = std::chrono::steady_clock::now();
+        }
+        ~Span();
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        bool active() const { return _name != nullptr; }
+        Span& arg(const char* name, const double value);
+
+    private:
+        const char* _name;
+        std::chrono::steady_clock::time_point _start;
+        const char* _arg_names[2] = {nullptr, nullptr};
+        double _args[2] = {0.0, 0.0};
+    };
+
+private:
+    static inline std::atomic<bool> _enabled{false};
+};
+} // namespace FRACTAL
+
+#endif // FRACT_TRACE_H